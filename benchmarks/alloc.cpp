@@ -0,0 +1,32 @@
+#include <cstddef> // std::size_t
+#include <cstdlib> // std::malloc, std::free
+#include <new>     // std::bad_alloc
+#include "bench.hpp"
+
+// 計測は単一スレッドで行うため、計数器は atomic にしない
+namespace {
+  std::size_t allocation_count = 0;
+} // namespace
+
+std::size_t
+bench::allocations() noexcept {
+  return allocation_count;
+}
+
+void*
+operator new(std::size_t n) {
+  ++allocation_count;
+  if (void* p = std::malloc(n == 0 ? 1 : n))
+    return p;
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
@@ -0,0 +1,68 @@
+/// @file bench.hpp
+#pragma once
+#include <chrono>
+#include <cstddef> // std::size_t
+#include <cstdio>  // std::printf
+#include <string_view>
+
+namespace bench {
+
+  // do_not_optimize
+  // 計測対象の結果を最適化で取り除かせない
+
+  template <class T>
+  inline void
+  do_not_optimize(const T& x) {
+    asm volatile("" : : "r,m"(x) : "memory");
+  }
+
+  // allocations
+  // これまでに operator new が呼ばれた回数 (alloc.cpp で置き換える)
+
+  std::size_t
+  allocations() noexcept;
+
+  // run
+  // 合計で 100ms 以上かかるまで反復回数を倍にしながら fn を呼び出し、1 回あたりの時間、
+  // 処理速度、ヒープ確保の回数を表示する。bytes は 1 回あたりに処理する入力の大きさ
+
+  template <class Fn>
+  void
+  run(std::string_view name, std::size_t bytes, Fn fn) {
+    using clock = std::chrono::steady_clock;
+    for (std::size_t n = 1;; n *= 2) {
+      const auto a0 = allocations();
+      const auto t0 = clock::now();
+      for (std::size_t i = 0; i < n; ++i)
+        fn();
+      const std::chrono::duration<double, std::nano> d = clock::now() - t0;
+      if (d.count() < 1e8)
+        continue;
+      const double ns = d.count() / static_cast<double>(n);
+      const double allocs = static_cast<double>(allocations() - a0) / static_cast<double>(n);
+      std::printf("%-56.*s %14.1f ns/op %10.1f MB/s %10.1f allocs/op\n",
+                  static_cast<int>(name.size()), name.data(), ns,
+                  static_cast<double>(bytes) / ns * 1e3, allocs);
+      break;
+    }
+  }
+
+  void
+  bounded();
+  void
+  escape();
+  void
+  parsed_template();
+  void
+  regex();
+  void
+  small_template();
+  void
+  split();
+  void
+  substitute();
+  void
+  trailing_view();
+  void
+  value_map();
+} // namespace bench
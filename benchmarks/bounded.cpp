@@ -0,0 +1,39 @@
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <strtpl/bounded.hpp>
+#include <strtpl/string_template.hpp>
+#include "bench.hpp"
+#include "corpus.hpp"
+
+void
+bench::bounded() {
+  // 上限を検査しながら basic_nfa_regex で照合する render_bounded と substitute (std::regex)
+  strtpl::render_limits limits;
+  limits.max_input = std::size_t{1} << 24;
+  limits.max_output = std::size_t{1} << 24;
+  for (const auto& c : corpora()) {
+    const corpus_map<char> m(c);
+    bench::run("substitute " + c.name, c.text.size(), [&] {
+      bench::do_not_optimize(strtpl::substitute(c.text, m.map));
+    });
+    bench::run("render_bounded " + c.name, c.text.size(), [&] {
+      bench::do_not_optimize(
+        strtpl::render_bounded(strtpl::substitute, std::string_view(c.text), m.map, limits));
+    });
+  }
+
+  // 照合が二乗の手間になる template: 上限に達して打ち切るまでの時間
+  const strtpl::string_template greedy{"$", "(x[^Q]*Q|x)"};
+  const std::unordered_map<std::string_view, std::string_view> xmap{{"x", "1"}};
+  std::string s;
+  for (int i = 0; i < (1 << 16); ++i)
+    s += "$x";
+  bench::run("render_bounded quadratic 128KB (limit)", s.size(), [&] {
+    try {
+      bench::do_not_optimize(strtpl::render_bounded(greedy, std::string_view(s), xmap, limits));
+    } catch (const strtpl::limit_exceeded& e) {
+      bench::do_not_optimize(e.offset());
+    }
+  });
+}
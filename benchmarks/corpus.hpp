@@ -0,0 +1,121 @@
+/// @file corpus.hpp
+#pragma once
+#include <cstddef> // std::size_t
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace bench {
+
+  // 計測用の入力を生成する。乱数を使わず、毎回同じ内容になる。
+  // 他の文字型の版はコード単位を一つずつ広げて作るため、ASCII 以外の文字を含む入力は
+  // char8_t でだけ使う
+
+  template <class CharT>
+  std::basic_string<CharT>
+  widen(std::string_view s) {
+    return {s.begin(), s.end()};
+  }
+
+  struct corpus {
+    std::string name;
+    std::string text;
+    // placeholder の key と値
+    std::vector<std::pair<std::string, std::string>> values;
+  };
+
+  // 短い定型文
+  inline corpus
+  short_template() {
+    return {"short", "Dear $name, your order #$order ships on ${date}.",
+            {{"name", "Alice"}, {"order", "12345"}, {"date", "2024-01-01"}}};
+  }
+
+  // placeholder がまばらな 1 MB の HTML
+  inline corpus
+  html_body() {
+    corpus c{"html 1MB", {}, {{"title", "Quarterly report"}, {"user", "alice"}, {"total", "$1,234"}}};
+    c.text = "<html><head><title>$title</title></head><body>\n";
+    for (std::size_t i = 0; c.text.size() < (1 << 20); ++i) {
+      c.text += "<div class=\"row\"><span>item " + std::to_string(i)
+                + "</span><p>Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+                  "eiusmod tempor incididunt ut labore et dolore magna aliqua.</p>";
+      if (i % 64 == 0)
+        c.text += "<p>Hello, ${user}! Total: $total ($$ USD)</p>";
+      c.text += "</div>\n";
+    }
+    c.text += "</body></html>\n";
+    return c;
+  }
+
+  // html_body と同じ構成で、本文と key に ASCII 以外の文字 (UTF-8) を含むもの
+  inline corpus
+  html_body_utf8() {
+    corpus c{"html 1MB utf-8", {}, {{"題名", "四半期報告"}, {"利用者", "アリス"}, {"合計", "¥1,234"}}};
+    c.text = "<html><head><title>$題名</title></head><body>\n";
+    for (std::size_t i = 0; c.text.size() < (1 << 20); ++i) {
+      c.text += "<div class=\"row\"><span>項目 " + std::to_string(i)
+                + "</span><p>吾輩は猫である。名前はまだ無い。どこで生れたかとんと見当がつかぬ。"
+                  "何でも薄暗いじめじめした所でニャーニャー泣いていた事だけは記憶している。</p>";
+      if (i % 64 == 0)
+        c.text += "<p>こんにちは、${利用者}さん。合計: $合計 ($$ 円)</p>";
+      c.text += "</div>\n";
+    }
+    c.text += "</body></html>\n";
+    return c;
+  }
+
+  // placeholder が密な SQL
+  inline corpus
+  placeholder_dense_sql() {
+    corpus c{"sql dense", {}, {}};
+    for (int i = 0; i < 16; ++i)
+      c.values.emplace_back("c" + std::to_string(i), "'value" + std::to_string(i) + "'");
+    c.text = "INSERT INTO t VALUES\n";
+    for (std::size_t i = 0; c.text.size() < (1 << 16); ++i) {
+      c.text += "($c0,$c1,$c2,$c3,$c4,$c5,$c6,$c7,${c8},${c9},${c10},${c11},$c12,$c13,$c14,$c15),\n";
+    }
+    return c;
+  }
+
+  // 病的な入力: 置換の無い長い文字列, 連続する $$, 長い識別子
+  inline std::vector<corpus>
+  pathological() {
+    std::vector<corpus> r;
+    r.push_back({"no placeholder 1MB", std::string(1 << 20, 'x'), {}});
+    r.push_back({"$$ dense", {}, {}});
+    for (std::size_t i = 0; i < (1 << 15); ++i)
+      r.back().text += "$$";
+    // std::regex は再帰で照合するため、識別子を長くしすぎるとスタックを使い果たす
+    const std::string id(1 << 10, 'a');
+    r.push_back({"long identifiers", {}, {{id, "v"}}});
+    for (int i = 0; i < 64; ++i)
+      r.back().text += "$" + id + " ";
+    return r;
+  }
+
+  inline std::vector<corpus>
+  corpora() {
+    std::vector<corpus> r{short_template(), html_body(), placeholder_dense_sql()};
+    for (auto& c : pathological())
+      r.push_back(std::move(c));
+    return r;
+  }
+
+  // key と値を string_view で引く map
+  template <class CharT>
+  struct corpus_map {
+    std::vector<std::pair<std::basic_string<CharT>, std::basic_string<CharT>>> storage;
+    std::unordered_map<std::basic_string_view<CharT>, std::basic_string_view<CharT>> map;
+
+    explicit corpus_map(const corpus& c) {
+      for (const auto& [k, v] : c.values)
+        storage.emplace_back(widen<CharT>(k), widen<CharT>(v));
+      for (const auto& [k, v] : storage)
+        map.emplace(k, v);
+    }
+    corpus_map(const corpus_map&) = delete;
+    corpus_map& operator=(const corpus_map&) = delete;
+  };
+} // namespace bench
@@ -0,0 +1,74 @@
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <strtpl/escape.hpp>
+#include <strtpl/parsed_template.hpp>
+#include "bench.hpp"
+#include "corpus.hpp"
+
+namespace {
+  // 一文字ずつ判定して追加する素朴なエスケープ
+  std::string
+  naive_html(std::string_view s) {
+    std::string r;
+    for (const char c : s) {
+      switch (c) {
+      case '&': r += "&amp;"; break;
+      case '<': r += "&lt;"; break;
+      case '>': r += "&gt;"; break;
+      case '"': r += "&quot;"; break;
+      case '\'': r += "&#39;"; break;
+      default: r += c;
+      }
+    }
+    return r;
+  }
+} // namespace
+
+void
+bench::escape() {
+  // 大部分が安全な文字の本文と、特殊文字が密な入力
+  const auto html = html_body().text;
+  std::string dense;
+  while (dense.size() < (1 << 16))
+    dense += "<a href=\"?x=1&y='2'\">\n";
+  for (const auto& [name, text] : {std::pair<std::string_view, const std::string&>{"html 1MB", html},
+                                   {"dense 64KB", dense}}) {
+    const std::string_view s = text;
+    bench::run("naive html " + std::string(name), s.size(),
+               [&] { bench::do_not_optimize(naive_html(s)); });
+    for (const auto& [e, ename] : {std::pair{strtpl::escape::html, "html"},
+                                   {strtpl::escape::json, "json"},
+                                   {strtpl::escape::url, "url"},
+                                   {strtpl::escape::shell, "shell"}}) {
+      bench::run("escaped_size " + std::string(ename) + " " + std::string(name), s.size(),
+                 [&] { bench::do_not_optimize(strtpl::escaped_size(e, s)); });
+      bench::run("escaped " + std::string(ename) + " " + std::string(name), s.size(),
+                 [&] { bench::do_not_optimize(strtpl::escaped(e, s)); });
+    }
+  }
+
+  // 値を事前にエスケープしてから置換する場合と、置換しながらエスケープする場合
+  std::unordered_map<std::string, std::string> raw;
+  std::string text;
+  for (int i = 0; i < 20; ++i) {
+    raw.emplace("v" + std::to_string(i), "<b>Tom & \"Jerry\"</b> #" + std::to_string(i));
+    text += "<li title=\"$v" + std::to_string(i) + "\">${v" + std::to_string(i) + "}</li>\n";
+  }
+  const auto t = strtpl::parse(strtpl::filtered_substitute, std::string_view(text));
+  std::unordered_map<std::string_view, std::string_view> values;
+  for (const auto& [k, v] : raw)
+    values.emplace(k, v);
+  bench::run("pre-escaped values + parsed_template (20 values)", text.size(), [&] {
+    std::unordered_map<std::string, std::string> escaped;
+    for (const auto& [k, v] : raw)
+      escaped.emplace(k, naive_html(v));
+    std::unordered_map<std::string_view, std::string_view> m;
+    for (const auto& [k, v] : escaped)
+      m.emplace(k, v);
+    bench::do_not_optimize(t(m));
+  });
+  bench::run("fused html parsed_template (20 values)", text.size(),
+             [&] { bench::do_not_optimize(t(values, strtpl::escape::html)); });
+}
@@ -0,0 +1,40 @@
+#include <cstdio> // std::printf
+#include <strtpl/instrumentation.hpp>
+#include "bench.hpp"
+
+int
+main() {
+  bench::bounded();
+  bench::escape();
+  bench::parsed_template();
+  bench::regex();
+  bench::small_template();
+  bench::split();
+  bench::substitute();
+  bench::trailing_view();
+  bench::value_map();
+
+  namespace instr = strtpl::instrumentation;
+#if STRTPL_INSTRUMENTATION
+  const auto stats = instr::snapshot();
+  std::printf("instrumentation: enabled\n");
+  std::printf("  renders %llu, replacements %llu, matches %llu, placeholders %llu\n",
+              static_cast<unsigned long long>(stats.renders),
+              static_cast<unsigned long long>(stats.replacements),
+              static_cast<unsigned long long>(stats.matches),
+              static_cast<unsigned long long>(stats.placeholders));
+  std::printf("  input %llu B, output %llu B, reallocations %llu, match %.3f s, copy %.3f s\n",
+              static_cast<unsigned long long>(stats.input_bytes),
+              static_cast<unsigned long long>(stats.output_bytes),
+              static_cast<unsigned long long>(stats.output_reallocations),
+              static_cast<double>(stats.match_ns) * 1e-9,
+              static_cast<double>(stats.copy_ns) * 1e-9);
+#else
+  // 無効のときは計数器が一度も確保されていないことを確かめる
+  if (instr::global_registry().head.load() != nullptr) {
+    std::printf("instrumentation: disabled, but counters were touched\n");
+    return 1;
+  }
+  std::printf("instrumentation: disabled (no counters touched)\n");
+#endif
+}
@@ -0,0 +1,132 @@
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <strtpl/parsed_template.hpp>
+#include <strtpl/render_chunks.hpp>
+#include <strtpl/string_template.hpp>
+#include "bench.hpp"
+#include "corpus.hpp"
+
+namespace {
+  // 名前と本文の異なる短い template を n 個作る
+  std::vector<std::pair<std::string, std::string>>
+  make_sources(std::size_t n) {
+    std::vector<std::pair<std::string, std::string>> r;
+    for (std::size_t i = 0; i < n; ++i)
+      r.emplace_back("mail/" + std::to_string(i) + ".txt",
+                     "Dear $name, your order #$order (" + std::to_string(i)
+                       + ") ships on ${date}.\nRegards, $$shop\n");
+    return r;
+  }
+} // namespace
+
+void
+bench::parsed_template() {
+  // 毎回解析する substitute と、解析済みの template の描画
+  for (const auto& c : corpora()) {
+    const corpus_map<char> m(c);
+    const auto t = strtpl::parse(strtpl::substitute, std::string_view(c.text));
+    bench::run("substitute " + c.name, c.text.size(), [&] {
+      bench::do_not_optimize(strtpl::substitute(c.text, m.map));
+    });
+    bench::run("parsed_template " + c.name, c.text.size(),
+               [&] { bench::do_not_optimize(t(m.map)); });
+    // 断片ごとに返す場合の、最初の断片までの時間と全体の時間
+    bench::run("render_chunks first chunk " + c.name, c.text.size(), [&] {
+      auto g = strtpl::render_chunks(t, m.map);
+      bench::do_not_optimize(*g.begin());
+    });
+    bench::run("render_chunks all " + c.name, c.text.size(), [&] {
+      std::size_t n = 0;
+      for (const auto chunk : strtpl::render_chunks(t, m.map))
+        n += chunk.size();
+      bench::do_not_optimize(n);
+    });
+    bench::run("substitute render_chunks first chunk " + c.name, c.text.size(), [&] {
+      auto g = strtpl::render_chunks(strtpl::substitute, std::string_view(c.text), m.map);
+      bench::do_not_optimize(*g.begin());
+    });
+    bench::run("parse " + c.name, c.text.size(), [&] {
+      bench::do_not_optimize(strtpl::parse(strtpl::substitute, std::string_view(c.text)));
+    });
+  }
+
+  // 起動時に多数の template を用意する費用: 全て解析するか、直列化した束を参照するか
+  constexpr std::size_t n = 20000;
+  const auto sources = make_sources(n);
+  std::size_t bytes = 0;
+  for (const auto& [name, text] : sources)
+    bytes += text.size();
+  std::vector<std::pair<std::string, strtpl::parsed_template>> items;
+  for (const auto& [name, text] : sources)
+    items.emplace_back(name, strtpl::parse(strtpl::substitute, std::string_view(text)));
+  const auto bundle = strtpl::make_template_bundle(items);
+  const auto suffix = " (" + std::to_string(n) + " templates)";
+
+  bench::run("parse all" + suffix, bytes, [&] {
+    std::vector<strtpl::parsed_template> r;
+    r.reserve(n);
+    for (const auto& [name, text] : sources)
+      r.push_back(strtpl::parse(strtpl::substitute, std::string_view(text)));
+    bench::do_not_optimize(r);
+  });
+  bench::run("make_template_bundle" + suffix, bytes,
+             [&] { bench::do_not_optimize(strtpl::make_template_bundle(items)); });
+  bench::run("template_bundle_view open" + suffix, bytes, [&] {
+    const strtpl::template_bundle_view v(bundle);
+    bench::do_not_optimize(v);
+  });
+  bench::run("template_bundle_view find all" + suffix, bytes, [&] {
+    const strtpl::template_bundle_view v(bundle);
+    std::size_t k = 0;
+    for (const auto& [name, text] : sources)
+      k += v.find(name)->key_count();
+    bench::do_not_optimize(k);
+  });
+
+  // 表の描画: 行ごとに substitute して連結するか、section で一度に描画するか
+  using map_type = std::unordered_map<std::string_view, std::string_view>;
+  constexpr std::size_t nrows = 1000;
+  std::vector<std::string> cells;
+  cells.reserve(nrows * 3);
+  std::vector<map_type> rows;
+  for (std::size_t i = 0; i < nrows; ++i) {
+    cells.push_back(std::to_string(i));
+    cells.push_back("item-" + std::to_string(i * 7919 % 1000));
+    cells.push_back(std::to_string(i * 37 % 10000) + ".00");
+  }
+  for (std::size_t i = 0; i < nrows; ++i)
+    rows.push_back({{"id", cells[i * 3]}, {"name", cells[i * 3 + 1]}, {"price", cells[i * 3 + 2]}});
+  const map_type page{{"title", "Price list"}, {"currency", "JPY"}};
+  const std::unordered_map<std::string_view, std::vector<map_type>> sections{{"rows", rows}};
+  // 行ごとに描画する場合は外側の値も各行の map に入れておく
+  auto full_rows = rows;
+  for (auto& m : full_rows)
+    m.emplace("currency", "JPY");
+  const std::string row_text = "<tr><td>$id</td><td>$name</td><td>$price $currency</td></tr>\n";
+  const std::string table_text =
+    "<h1>$title</h1>\n<table>\n${#rows}" + row_text + "${/rows}</table>\n";
+  const auto table = strtpl::parse(strtpl::section_substitute, std::string_view(table_text));
+  const auto row = strtpl::parse(strtpl::substitute, std::string_view(row_text));
+  const std::size_t table_bytes = table(page, sections).size();
+  const auto rsuffix = " (" + std::to_string(nrows) + " rows)";
+
+  bench::run("substitute per row" + rsuffix, table_bytes, [&] {
+    std::string r = strtpl::substitute("<h1>$title</h1>\n<table>\n", page);
+    for (const auto& m : full_rows)
+      r += strtpl::substitute(row_text, m);
+    r += "</table>\n";
+    bench::do_not_optimize(r);
+  });
+  bench::run("parsed_template per row" + rsuffix, table_bytes, [&] {
+    std::string r = strtpl::substitute("<h1>$title</h1>\n<table>\n", page);
+    for (const auto& m : full_rows)
+      r += row(m);
+    r += "</table>\n";
+    bench::do_not_optimize(r);
+  });
+  bench::run("section" + rsuffix, table_bytes,
+             [&] { bench::do_not_optimize(table(page, sections)); });
+}
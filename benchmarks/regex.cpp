@@ -0,0 +1,39 @@
+#include <regex>
+#include <string>
+#include <string_view>
+#include <strtpl/regex.hpp>
+#include "bench.hpp"
+
+namespace {
+  std::string
+  make_corpus(std::size_t n) {
+    std::string s;
+    for (std::size_t i = 0; s.size() < n; ++i)
+      s += "lorem ipsum " + std::to_string(i) + " dolor sit amet\n";
+    return s;
+  }
+} // namespace
+
+void
+bench::regex() {
+  const std::string corpus = make_corpus(1 << 16);
+  const std::string_view s = corpus;
+  const std::regex re{R"(\d+)"};
+  constexpr auto fn = [](auto&&) -> std::string_view { return "N"; };
+
+  run("regex::regex_replace_fn (eager)", s.size(), [&] {
+    do_not_optimize(strtpl::regex::regex_replace_fn(s, re, fn));
+  });
+  run("regex::v2::regex_replace_fn (lazy, materialized)", s.size(), [&] {
+    std::string r;
+    for (const auto& chunk : strtpl::regex::v2::regex_replace_fn(s, re, fn))
+      r.append(chunk);
+    do_not_optimize(r);
+  });
+  run("regex::v2::regex_replace_fn (lazy, streamed)", s.size(), [&] {
+    std::size_t n = 0;
+    for (const auto& chunk : strtpl::regex::v2::regex_replace_fn(s, re, fn))
+      n += chunk.size();
+    do_not_optimize(n);
+  });
+}
@@ -0,0 +1,30 @@
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <strtpl/parsed_template.hpp>
+#include <strtpl/small_template.hpp>
+#include <strtpl/string_template.hpp>
+#include <strtpl/value_map.hpp>
+#include "bench.hpp"
+
+void
+bench::small_template() {
+  // ログやメトリクスのラベルのような 128 バイト未満で placeholder が 1〜3 個の template
+  const std::unordered_map<std::string_view, std::string_view> map{
+    {"service", "checkout"}, {"region", "ap-northeast-1"}, {"code", "503"}};
+  const strtpl::value_map vmap{
+    {"service", "checkout"}, {"region", "ap-northeast-1"}, {"code", "503"}};
+  constexpr std::string_view templates[] = {"request failed: $code",
+                                            "service=$service,region=${region},code=$code"};
+  for (const std::string_view s : templates) {
+    const auto suffix = " (" + std::to_string(s.size()) + " B)";
+    bench::run("substitute" + suffix, s.size(),
+               [&] { bench::do_not_optimize(strtpl::substitute(s, map)); });
+    const auto t = strtpl::parse(strtpl::substitute, s);
+    bench::run("parsed_template" + suffix, s.size(), [&] { bench::do_not_optimize(t(map)); });
+    bench::run("render_small" + suffix, s.size(),
+               [&] { bench::do_not_optimize(strtpl::render_small(s, map)); });
+    bench::run("render_small, value_map" + suffix, s.size(),
+               [&] { bench::do_not_optimize(strtpl::render_small(s, vmap)); });
+  }
+}
@@ -0,0 +1,61 @@
+#include <regex>
+#include <string>
+#include <string_view>
+#include <strtpl/literal_split.hpp>
+#include <strtpl/regex.hpp>
+#include "bench.hpp"
+
+namespace {
+  std::string
+  make_log(std::size_t n) {
+    std::string s;
+    for (std::size_t i = 0; s.size() < n; ++i)
+      s += "2024-01-01T00:00:00Z INFO request id=" + std::to_string(i) + " status=200 ok\n";
+    return s;
+  }
+} // namespace
+
+void
+bench::split() {
+  const std::string corpus = make_log(1 << 20);
+  const std::string_view s = corpus;
+  const std::regex re{"\n"};
+
+  run("regex::v2::regex_split (lines)", s.size(), [&] {
+    std::size_t n = 0;
+    for (const auto& line : strtpl::regex::v2::regex_split(s, re))
+      n += static_cast<std::size_t>(std::ranges::distance(line));
+    do_not_optimize(n);
+  });
+  // 長い行の先頭の 3 フィールドだけを取り出す
+  const std::string line = "GET /index.html HTTP/1.1 " + std::string(1 << 20, 'x');
+  const std::string_view ls = line;
+  const std::regex space{" "};
+  run("regex::v2::regex_split_n (long line)", ls.size(), [&] {
+    std::size_t n = 0;
+    for (const auto& field : strtpl::regex::v2::regex_split_n(ls, space, 3))
+      n += static_cast<std::size_t>(std::ranges::distance(field));
+    do_not_optimize(n);
+  });
+  run("regex::v2::regex_split | take(4) (long line)", ls.size(), [&] {
+    std::size_t n = 0;
+    for (const auto& field : strtpl::regex::v2::regex_split(ls, space) | std::views::take(4))
+      n += static_cast<std::size_t>(std::ranges::distance(field));
+    do_not_optimize(n);
+  });
+  run("literal_split (lines)", s.size(), [&] {
+    std::size_t n = 0;
+    for (const auto& line : strtpl::literal_split(s, '\n'))
+      n += line.size();
+    do_not_optimize(n);
+  });
+  run("literal_split::count (lines)", s.size(), [&] {
+    do_not_optimize(strtpl::literal_split(s, '\n').count());
+  });
+  run("literal_split (\" status=\")", s.size(), [&] {
+    std::size_t n = 0;
+    for (const auto& field : strtpl::literal_split(s, std::string_view(" status=")))
+      n += field.size();
+    do_not_optimize(n);
+  });
+}
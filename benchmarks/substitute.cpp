@@ -0,0 +1,64 @@
+#include <regex>
+#include <string>
+#include <string_view>
+#include <strtpl/nfa_regex.hpp>
+#include <strtpl/string_template.hpp>
+#include "bench.hpp"
+#include "corpus.hpp"
+
+namespace {
+  // strtpl::substitute が内部で組み立てるものと同じ正規表現
+  constexpr std::string_view pattern =
+    R"(\$(?:([_a-zA-Z][_a-zA-Z0-9]*)|\{([_a-zA-Z][_a-zA-Z0-9]*)\}|(\$)|()))";
+  constexpr std::string_view idpattern = "([_a-zA-Z][_a-zA-Z0-9]*)";
+
+  template <class CharT>
+  void
+  run_corpus(const bench::corpus& c, std::string_view char_name) {
+    using string_view_type = std::basic_string_view<CharT>;
+    const auto text = bench::widen<CharT>(c.text);
+    const string_view_type s = text;
+    const bench::corpus_map<CharT> values(c);
+    const auto& map = values.map;
+    const auto bytes = text.size() * sizeof(CharT);
+    const auto name = [&](std::string_view what) {
+      return std::string(what) + " (" + c.name + ", " + std::string(char_name) + ")";
+    };
+
+    const auto delim = bench::widen<CharT>("$");
+    const auto id = bench::widen<CharT>(idpattern);
+    const strtpl::basic_string_template<CharT> std_tpl{delim, id};
+    const strtpl::basic_string_template<CharT, std::char_traits<CharT>,
+                                        strtpl::basic_nfa_regex<CharT>>
+      nfa_tpl{delim, id};
+    bench::run(name("substitute"), bytes, [&] { bench::do_not_optimize(std_tpl(s, map)); });
+    bench::run(name("substitute<nfa_regex>"), bytes, [&] { bench::do_not_optimize(nfa_tpl(s, map)); });
+
+    // 比較対象: 同じ正規表現で、一致を固定の文字列に置き換えるだけの std::regex_replace
+    const std::basic_regex<CharT> re(bench::widen<CharT>(pattern));
+    const auto fmt = bench::widen<CharT>("X");
+    bench::run(name("std::regex_replace"), bytes, [&] {
+      bench::do_not_optimize(std::regex_replace(text, re, fmt));
+    });
+  }
+
+  // UTF-8 の入力をコード単位のまま走査する。ASCII だけの入力と同じ速さになるはず
+  void
+  run_utf8(const bench::corpus& c) {
+    const auto text = bench::widen<char8_t>(c.text);
+    const bench::corpus_map<char8_t> values(c);
+    bench::run("u8substitute (" + c.name + ", char8_t)", text.size(), [&] {
+      bench::do_not_optimize(strtpl::u8substitute(std::u8string_view(text), values.map));
+    });
+  }
+} // namespace
+
+void
+bench::substitute() {
+  for (const auto& c : corpora()) {
+    run_corpus<char>(c, "char");
+    run_corpus<wchar_t>(c, "wchar_t");
+  }
+  run_utf8(html_body());
+  run_utf8(html_body_utf8());
+}
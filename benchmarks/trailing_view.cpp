@@ -0,0 +1,27 @@
+#include <numeric> // std::iota
+#include <vector>
+#include <strtpl/trailing_view.hpp>
+#include "bench.hpp"
+
+void
+bench::trailing_view() {
+  std::vector<int> v(1 << 16);
+  std::iota(v.begin(), v.end(), 0);
+  const auto bytes = v.size() * sizeof(int);
+
+  run("trailing_view (iterate)", bytes, [&] {
+    long n = 0;
+    for (const auto& [x, count] : strtpl::trailing_view{v, 2})
+      n += x + count;
+    do_not_optimize(n);
+  });
+  run("trailing_view (index)", bytes, [&] {
+    auto tv = strtpl::trailing_view{v, 2};
+    long n = 0;
+    for (std::ptrdiff_t i = 0, size = std::ranges::ssize(tv); i < size; i += 7) {
+      const auto [x, count] = tv[i];
+      n += x + count;
+    }
+    do_not_optimize(n);
+  });
+}
@@ -0,0 +1,80 @@
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <strtpl/nfa_regex.hpp>
+#include <strtpl/string_template.hpp>
+#include <strtpl/value_map.hpp>
+#include "bench.hpp"
+#include "corpus.hpp"
+
+namespace {
+  // 典型的な template の key の集合
+  std::vector<std::pair<std::string, std::string>>
+  make_pairs(std::size_t n) {
+    constexpr std::string_view names[] = {
+      "id",      "name",    "email",   "title",   "date",    "user",    "total",   "price",
+      "count",   "status",  "url",     "path",    "host",    "port",    "query",   "lang",
+      "country", "city",    "zip",     "phone",   "company", "role",    "version", "build",
+      "branch",  "commit",  "author",  "message", "created", "updated",
+    };
+    std::vector<std::pair<std::string, std::string>> r;
+    for (std::size_t i = 0; i < n; ++i)
+      r.emplace_back(names[i], "value of " + std::string(names[i]));
+    return r;
+  }
+
+  template <class Map>
+  void
+  run_lookup(std::string_view name, const Map& map, const std::vector<std::string_view>& queries) {
+    bench::run(name, 0, [&] {
+      std::size_t n = 0;
+      for (const auto& q : queries)
+        n += std::string_view(strtpl::at(map, q)).size();
+      bench::do_not_optimize(n);
+    });
+  }
+} // namespace
+
+void
+bench::value_map() {
+  for (const std::size_t n : {5, 15, 30}) {
+    const auto pairs = make_pairs(n);
+    // 全ての key を 8 回ずつ引く
+    std::vector<std::string_view> queries;
+    for (int i = 0; i < 8; ++i)
+      for (const auto& [k, v] : pairs)
+        queries.emplace_back(k);
+
+    const strtpl::value_map vmap(pairs);
+    std::unordered_map<std::string_view, std::string_view> svmap;
+    for (const auto& [k, v] : pairs)
+      svmap.emplace(k, v);
+    const strtpl::unordered_string_map<std::string> umap(pairs.begin(), pairs.end());
+    const strtpl::string_map<std::string> smap(pairs.begin(), pairs.end());
+    const std::unordered_map<std::string, std::string> plain(pairs.begin(), pairs.end());
+
+    const auto suffix = " (" + std::to_string(n) + " keys, " + std::to_string(queries.size())
+                        + " lookups)";
+    run_lookup("value_map" + suffix, vmap, queries);
+    run_lookup("unordered_map<string_view>" + suffix, svmap, queries);
+    run_lookup("unordered_string_map" + suffix, umap, queries);
+    run_lookup("string_map" + suffix, smap, queries);
+    run_lookup("transparent(unordered_map<string>)" + suffix, strtpl::transparent(plain),
+               queries);
+  }
+
+  // placeholder が密な入力の置換全体
+  const auto c = placeholder_dense_sql();
+  const std::string_view s = c.text;
+  const strtpl::value_map vmap(c.values);
+  const corpus_map<char> svmap(c);
+  const strtpl::basic_string_template<char, std::char_traits<char>, strtpl::nfa_regex> tpl{
+    "$", "([_a-zA-Z][_a-zA-Z0-9]*)"};
+  run("substitute<nfa_regex> (sql dense, value_map)", s.size(),
+      [&] { do_not_optimize(tpl(s, vmap)); });
+  run("substitute<nfa_regex> (sql dense, unordered_map)", s.size(),
+      [&] { do_not_optimize(tpl(s, svmap.map)); });
+}
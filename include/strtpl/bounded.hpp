@@ -0,0 +1,186 @@
+/// @file bounded.hpp
+#pragma once
+#include <cstddef> // std::size_t, std::ptrdiff_t
+#include <cstdint> // std::uint8_t
+#include <regex>   // std::regex_constants
+#include <span>
+#include <stdexcept> // std::runtime_error
+#include <string>
+#include <string_view>
+#include <strtpl/instrumentation.hpp>
+#include <strtpl/nfa_regex.hpp>
+#include <strtpl/regex_engine.hpp>
+#include <strtpl/string_template.hpp>
+
+namespace strtpl::inline STRTPL_INSTRUMENTATION_NAMESPACE {
+
+  // render_limits
+  // render_bounded が使う資源の上限。長さはコード単位の数で数える
+  //   max_input         入力の長さ
+  //   max_output        出力の長さ
+  //   max_placeholders  置き換える placeholder の数
+  //   max_nesting       placeholder を探す正規表現のグループの入れ子の深さ
+  //   max_steps         照合で処理する NFA のスレッドの延べ数
+
+  struct render_limits {
+    std::size_t max_input = std::size_t{1} << 20;
+    std::size_t max_output = std::size_t{1} << 22;
+    std::size_t max_placeholders = std::size_t{1} << 16;
+    std::size_t max_nesting = 32;
+    std::size_t max_steps = std::size_t{1} << 24;
+  };
+
+  enum class render_limit : std::uint8_t { input, output, placeholders, nesting, steps };
+
+  inline constexpr const char*
+  render_limit_name(render_limit which) noexcept {
+    switch (which) {
+    case render_limit::input: return "input";
+    case render_limit::output: return "output";
+    case render_limit::placeholders: return "placeholders";
+    case render_limit::nesting: return "nesting";
+    default: return "steps";
+    }
+  }
+
+  // limit_exceeded
+  // render_bounded が上限を超えたときに送出する。which() は超えた上限、offset() はそのときに
+  // 処理していた入力の位置 (input と nesting では 0)
+
+  class limit_exceeded : public std::runtime_error {
+  private:
+    render_limit which_;
+    std::size_t offset_;
+
+  public:
+    limit_exceeded(render_limit which, std::size_t offset)
+      : std::runtime_error(std::string("Error: ") + render_limit_name(which)
+                           + " limit exceeded: offset " + std::to_string(offset)),
+        which_(which), offset_(offset) {}
+
+    render_limit
+    which() const noexcept {
+      return which_;
+    }
+    std::size_t
+    offset() const noexcept {
+      return offset_;
+    }
+  };
+
+  namespace _bounded {
+    // 作業領域を使い回し、全ての照合で一つの nfa_budget を消費する regex_engine
+    template <class CharT>
+    class engine {
+    public:
+      using value_type = CharT;
+
+    private:
+      const basic_nfa_regex<CharT>* re_;
+      mutable nfa_workspace ws_{};
+      mutable nfa_budget budget_;
+      mutable std::ptrdiff_t exhausted_at_ = -1;
+
+    public:
+      engine(const basic_nfa_regex<CharT>& re, std::size_t steps) : re_(&re), budget_{steps} {}
+
+      std::size_t
+      mark_count() const noexcept {
+        return re_->mark_count();
+      }
+      // 手間の上限に達した照合の開始位置 (達していなければ -1)
+      std::ptrdiff_t
+      exhausted_at() const noexcept {
+        return exhausted_at_;
+      }
+
+      template <class BiIter>
+      bool
+      search_from(BiIter first, BiIter last, std::ptrdiff_t pos, std::span<std::ptrdiff_t> caps,
+                  std::regex_constants::match_flag_type flags =
+                    std::regex_constants::match_default) const {
+        const auto& prog = re_->program();
+        const bool r = nfa_execute(std::span<const nfa_inst>(prog.insts),
+                                   std::span<const nfa_range>(prog.ranges),
+                                   ws_.prepare(prog.insts.size(), caps.size()), first, last, pos,
+                                   caps, flags, &budget_);
+        if (budget_.exhausted and exhausted_at_ < 0)
+          exhausted_at_ = pos;
+        return r;
+      }
+      template <class BiIter>
+      bool
+      match_at(BiIter first, BiIter last, std::ptrdiff_t pos, std::span<std::ptrdiff_t> caps,
+               std::regex_constants::match_flag_type flags =
+                 std::regex_constants::match_default) const {
+        return search_from(first, last, pos, caps, flags | std::regex_constants::match_continuous);
+      }
+    };
+  } // namespace _bounded
+
+  // render_bounded
+  // 信頼できない template のための tpl(s, map)。Regex に関わらず tpl の pattern を basic_nfa_regex
+  // に変換して照合するため、入力に依存してスタックを消費しない。各上限は照合と出力のたびに検査し、
+  // 超えた時点で limit_exceeded を送出する。照合の手間は max_steps で、出力は max_output で抑えられ、
+  // 不正な placeholder の行番号と列番号を求めるのも一度だけなので、全体の時間は入力と出力の長さに
+  // 対して線形である。見つからない key と不正な placeholder は tpl(s, map) と同じ例外を送出する。
+  // 値は tpl(s, map) と異なり書式として解釈せずにそのままコピーする
+
+  template <class CharT, class ST, class Regex, class Map>
+  requires map_with_key_type<const Map, std::basic_string_view<CharT, ST>>
+  std::basic_string<CharT, ST>
+  render_bounded(const basic_string_template<CharT, ST, Regex>& tpl,
+                 std::basic_string_view<CharT, ST> s, const Map& map,
+                 const render_limits& limits = {}) {
+    using string_view_type = std::basic_string_view<CharT, ST>;
+    using BiIter = typename string_view_type::iterator;
+    using Iter = engine_iterator<BiIter, _bounded::engine<CharT>>;
+    STRTPL_INSTRUMENT_ADD(renders, 1);
+    if (s.size() > limits.max_input)
+      throw limit_exceeded(render_limit::input, 0);
+    const auto pattern = tpl.pattern();
+    if (nfa_nesting_depth(std::basic_string_view<CharT>(pattern.data(), pattern.size()))
+        > limits.max_nesting)
+      throw limit_exceeded(render_limit::nesting, 0);
+    const basic_nfa_regex<CharT> re(pattern);
+    const _bounded::engine<CharT> eng(re, limits.max_steps);
+
+    const auto pos = [&s](BiIter i) { return static_cast<std::size_t>(i - s.begin()); };
+    const auto slice = [&](BiIter first, BiIter last) {
+      return s.substr(pos(first), static_cast<std::size_t>(last - first));
+    };
+    std::basic_string<CharT, ST> r;
+    r.reserve(s.size() < limits.max_output ? s.size() : limits.max_output);
+    const auto put = [&](string_view_type x, BiIter at) {
+      if (x.size() > limits.max_output - r.size())
+        throw limit_exceeded(render_limit::output, pos(at));
+      r.append(x);
+    };
+
+    std::size_t placeholders = 0;
+    BiIter last = s.begin();
+    for (Iter i(s.begin(), s.end(), eng, tpl.match_flags()), end; i != end; ++i) {
+      const auto& mo = *i;
+      put(slice(last, mo[0].first), last);
+      last = mo[0].second;
+      if (mo[1].matched or mo[2].matched) {
+        if (++placeholders > limits.max_placeholders)
+          throw limit_exceeded(render_limit::placeholders, pos(mo[0].first));
+        const auto id = mo[1].matched ? mo[1] : mo[2];
+        put(string_view_type(at(map, slice(id.first, id.second))), mo[0].first);
+        STRTPL_INSTRUMENT_ADD(placeholders, 1);
+      } else if (mo[3].matched) {
+        put(slice(mo[3].first, mo[3].second), mo[0].first);
+      } else if (mo[4].matched) {
+        _invalid(s.begin(), mo[0].first);
+      } else {
+        throw std::runtime_error("Unrecognized group in pattern");
+      }
+    }
+    if (eng.exhausted_at() >= 0)
+      throw limit_exceeded(render_limit::steps, static_cast<std::size_t>(eng.exhausted_at()));
+    put(slice(last, s.end()), last);
+    STRTPL_INSTRUMENT_ADD(output_bytes, r.size() * sizeof(CharT));
+    return r;
+  }
+} // namespace strtpl::inline STRTPL_INSTRUMENTATION_NAMESPACE
@@ -0,0 +1,59 @@
+/// @file compiled.hpp
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <strtpl/fwd.hpp>
+#include <strtpl/parsed_template.hpp>
+#include <strtpl/string_template.hpp>
+#include <strtpl/value_map.hpp>
+
+// ライブラリは STRTPL_INSTRUMENTATION=0 で実体化する (strtpl::_plain の実体)。計測を有効にした
+// 翻訳単位では extern template の宣言が strtpl::_instrumented の実体を指し、ライブラリに定義が無いため拒否する
+#if STRTPL_INSTRUMENTATION
+#error "strtpl/compiled.hpp cannot be used with STRTPL_INSTRUMENTATION=1"
+#endif
+
+// StrTpl::compiled ライブラリで明示的に実体化するもの。
+// このヘッダを読み込んだ翻訳単位は以下を実体化せず、ライブラリの定義を使う。
+// 正規表現の構築と照合を含む置換の本体はライブラリで一度だけ生成されるが、<regex> などの
+// 読み込みは避けられない。読み込みも避けるには fwd.hpp の strtpl::compiled::substitute を使う
+
+namespace strtpl {
+
+  template <class CharT>
+  using compiled_string_map =
+    std::unordered_map<std::basic_string_view<CharT>, std::basic_string_view<CharT>>;
+
+  extern template struct basic_string_template<char>;
+  extern template struct basic_string_template<wchar_t>;
+  extern template class basic_value_map<char>;
+  extern template class basic_value_map<wchar_t>;
+  extern template class basic_template_view<char>;
+  extern template class basic_template_view<wchar_t>;
+  extern template class basic_parsed_template<char>;
+  extern template class basic_parsed_template<wchar_t>;
+
+  extern template std::string
+  string_template::operator()(std::string_view, const compiled_string_map<char>&) const;
+  extern template std::string
+  string_template::operator()(std::string_view, const value_map&) const;
+  extern template std::wstring
+  wstring_template::operator()(std::wstring_view, const compiled_string_map<wchar_t>&) const;
+  extern template std::wstring
+  wstring_template::operator()(std::wstring_view, const wvalue_map&) const;
+
+  extern template parsed_template
+  parse(const string_template&, std::string_view);
+  extern template wparsed_template
+  parse(const wstring_template&, std::wstring_view);
+
+  extern template std::string
+  template_view::operator()(const compiled_string_map<char>&, escape) const;
+  extern template std::string
+  template_view::operator()(const value_map&, escape) const;
+  extern template std::wstring
+  wtemplate_view::operator()(const compiled_string_map<wchar_t>&, escape) const;
+  extern template std::wstring
+  wtemplate_view::operator()(const wvalue_map&, escape) const;
+} // namespace strtpl
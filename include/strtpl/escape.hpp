@@ -0,0 +1,344 @@
+/// @file escape.hpp
+#pragma once
+#include <algorithm> // std::copy
+#include <cstddef>   // std::size_t
+#include <cstdint>   // std::uint8_t, std::uint32_t
+#include <iterator>  // std::back_inserter
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits> // std::make_unsigned_t
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace strtpl {
+
+  // escape
+  // 値を出力に書き込むときに施すエスケープ
+  //   html   & < > " ' を文字参照にする
+  //   json   JSON の文字列の中身として " \ と制御文字をエスケープする (引用符は付けない)
+  //   url    RFC 3986 の非予約文字 (英数字と - . _ ~) 以外を %XX にする。
+  //          コード単位をバイトとして扱うため、1 バイトの文字型 (UTF-8) だけに対応する
+  //   shell  全体を '...' で囲み、' を '\'' にする (POSIX sh の単一の引数になる)
+
+  enum class escape : std::uint8_t { none, html, json, url, shell };
+
+  inline constexpr std::optional<escape>
+  escape_from_name(std::string_view name) noexcept {
+    if (name == "none" or name == "raw")
+      return escape::none;
+    if (name == "html")
+      return escape::html;
+    if (name == "json")
+      return escape::json;
+    if (name == "url")
+      return escape::url;
+    if (name == "shell")
+      return escape::shell;
+    return std::nullopt;
+  }
+
+  template <class CharT>
+  constexpr bool
+  escape_supported(escape e) noexcept {
+    return e != escape::url or sizeof(CharT) == 1;
+  }
+
+  namespace _escape {
+
+    template <class CharT>
+    constexpr std::uint32_t
+    code(CharT c) noexcept {
+      return static_cast<std::uint32_t>(static_cast<std::make_unsigned_t<CharT>>(c));
+    }
+
+    template <class CharT, class OutputIter>
+    constexpr OutputIter
+    put(std::string_view s, OutputIter out) {
+      for (const char c : s)
+        *out++ = static_cast<CharT>(c);
+      return out;
+    }
+
+    template <class CharT, class OutputIter>
+    constexpr OutputIter
+    put_hex(std::uint32_t x, int digits, OutputIter out) {
+      constexpr std::string_view hex = "0123456789ABCDEF";
+      for (int i = digits - 1; i >= 0; --i)
+        *out++ = static_cast<CharT>(hex[(x >> (4 * i)) & 0xf]);
+      return out;
+    }
+
+    // 値の中の安全な文字の並びは短いことが多いため、短い並びは memmove を呼ばずにコピーする
+    template <class CharT, class OutputIter>
+    constexpr OutputIter
+    copy_run(const CharT* first, const CharT* last, OutputIter out) {
+      if (last - first >= 32)
+        return std::copy(first, last, out);
+      for (; first != last; ++first)
+        *out++ = *first;
+      return out;
+    }
+
+    // 各 kernel は
+    //   extra(c)    c を書き込むときに増える文字数 (0 ならば安全な文字)
+    //   extra16(x)  16 バイトの各バイトについての extra (1 バイトの文字型で SSE2 が使えるとき)
+    //   max_extra   extra の最大値
+    //   write(c, out)
+    // を持つ
+
+    struct html {
+      static constexpr std::size_t max_extra = 5;
+
+      static constexpr std::size_t
+      extra(std::uint32_t c) noexcept {
+        switch (c) {
+        case '&': return 4;
+        case '<': return 3;
+        case '>': return 3;
+        case '"': return 5;
+        case '\'': return 4;
+        default: return 0;
+        }
+      }
+#if defined(__SSE2__)
+      static __m128i
+      extra16(__m128i x) noexcept {
+        const auto eq = [x](char c, char n) {
+          return _mm_and_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(c)), _mm_set1_epi8(n));
+        };
+        return _mm_or_si128(_mm_or_si128(_mm_or_si128(eq('&', 4), eq('<', 3)),
+                                         _mm_or_si128(eq('>', 3), eq('"', 5))),
+                            eq('\'', 4));
+      }
+#endif
+      template <class CharT, class OutputIter>
+      static constexpr OutputIter
+      write(CharT c, OutputIter out) {
+        switch (code(c)) {
+        case '&': return put<CharT>("&amp;", out);
+        case '<': return put<CharT>("&lt;", out);
+        case '>': return put<CharT>("&gt;", out);
+        case '"': return put<CharT>("&quot;", out);
+        default: return put<CharT>("&#39;", out);
+        }
+      }
+    };
+
+    struct json {
+      static constexpr std::size_t max_extra = 5;
+
+      static constexpr std::size_t
+      extra(std::uint32_t c) noexcept {
+        switch (c) {
+        case '"':
+        case '\\':
+        case '\b':
+        case '\f':
+        case '\n':
+        case '\r':
+        case '\t': return 1;
+        default: return c < 0x20 ? 5 : 0;
+        }
+      }
+#if defined(__SSE2__)
+      static __m128i
+      extra16(__m128i x) noexcept {
+        const auto eq = [x](char c) { return _mm_cmpeq_epi8(x, _mm_set1_epi8(c)); };
+        const __m128i ctrl =
+          _mm_cmpeq_epi8(_mm_max_epu8(x, _mm_set1_epi8(0x1f)), _mm_set1_epi8(0x1f));
+        const __m128i short_ctrl =
+          _mm_or_si128(_mm_or_si128(eq('\b'), eq('\f')),
+                       _mm_or_si128(eq('\n'), _mm_or_si128(eq('\r'), eq('\t'))));
+        const __m128i quote = _mm_or_si128(eq('"'), eq('\\'));
+        // 制御文字は 5、そのうち短い形式のものは 5 - 4 = 1
+        return _mm_or_si128(_mm_sub_epi8(_mm_and_si128(ctrl, _mm_set1_epi8(5)),
+                                         _mm_and_si128(short_ctrl, _mm_set1_epi8(4))),
+                            _mm_and_si128(quote, _mm_set1_epi8(1)));
+      }
+#endif
+      template <class CharT, class OutputIter>
+      static constexpr OutputIter
+      write(CharT c, OutputIter out) {
+        switch (code(c)) {
+        case '"': return put<CharT>("\\\"", out);
+        case '\\': return put<CharT>("\\\\", out);
+        case '\b': return put<CharT>("\\b", out);
+        case '\f': return put<CharT>("\\f", out);
+        case '\n': return put<CharT>("\\n", out);
+        case '\r': return put<CharT>("\\r", out);
+        case '\t': return put<CharT>("\\t", out);
+        default: return put_hex<CharT>(code(c), 4, put<CharT>("\\u", out));
+        }
+      }
+    };
+
+    struct url {
+      static constexpr std::size_t max_extra = 2;
+
+      static constexpr std::size_t
+      extra(std::uint32_t c) noexcept {
+        const bool safe = (c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z')
+                          or (c >= '0' and c <= '9') or c == '-' or c == '.' or c == '_'
+                          or c == '~';
+        return safe ? 0 : 2;
+      }
+#if defined(__SSE2__)
+      static __m128i
+      extra16(__m128i x) noexcept {
+        // 符号無しの比較 a <= x - lo <= a + n を min で行う
+        const auto in_range = [](__m128i v, char lo, char n) {
+          const __m128i d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+          return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(n)), d);
+        };
+        const auto eq = [x](char c) { return _mm_cmpeq_epi8(x, _mm_set1_epi8(c)); };
+        // 0x20 を立てると英大文字は小文字になり、他の文字は英字にならない
+        const __m128i alpha = in_range(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 25);
+        const __m128i punct =
+          _mm_or_si128(_mm_or_si128(eq('-'), eq('.')), _mm_or_si128(eq('_'), eq('~')));
+        const __m128i safe = _mm_or_si128(_mm_or_si128(alpha, in_range(x, '0', 9)), punct);
+        return _mm_andnot_si128(safe, _mm_set1_epi8(2));
+      }
+#endif
+      template <class CharT, class OutputIter>
+      static constexpr OutputIter
+      write(CharT c, OutputIter out) {
+        *out++ = static_cast<CharT>('%');
+        return put_hex<CharT>(code(c), 2, out);
+      }
+    };
+
+    struct shell {
+      static constexpr std::size_t max_extra = 3;
+
+      static constexpr std::size_t
+      extra(std::uint32_t c) noexcept {
+        return c == '\'' ? 3 : 0;
+      }
+#if defined(__SSE2__)
+      static __m128i
+      extra16(__m128i x) noexcept {
+        return _mm_and_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\'')), _mm_set1_epi8(3));
+      }
+#endif
+      template <class CharT, class OutputIter>
+      static constexpr OutputIter
+      write(CharT, OutputIter out) {
+        return put<CharT>("'\\''", out);
+      }
+    };
+
+    template <class Kernel, class CharT>
+    std::size_t
+    sum_extra(const CharT* p, std::size_t n) noexcept {
+      std::size_t r = 0;
+#if defined(__SSE2__)
+      if constexpr (sizeof(CharT) == 1) {
+        // 8 bit の計数器があふれる前に _mm_sad_epu8 で合計する
+        constexpr std::size_t block = 255 / Kernel::max_extra;
+        const __m128i zero = _mm_setzero_si128();
+        while (n >= 16) {
+          __m128i acc = zero;
+          const std::size_t k = n / 16 < block ? n / 16 : block;
+          for (std::size_t i = 0; i < k; ++i, p += 16)
+            acc = _mm_add_epi8(
+              acc, Kernel::extra16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+          n -= k * 16;
+          const __m128i sum = _mm_sad_epu8(acc, zero);
+          r += static_cast<std::size_t>(_mm_cvtsi128_si32(sum))
+               + static_cast<std::size_t>(_mm_extract_epi16(sum, 4));
+        }
+      }
+#endif
+      for (; n != 0; ++p, --n)
+        r += Kernel::extra(code(*p));
+      return r;
+    }
+
+    // 安全な文字の並びはまとめてコピーし、それ以外の文字だけを Kernel::write で書き込む。
+    // SSE2 では 16 バイトごとに安全でない文字の位置を bit mask として求め、mask の bit を順に処理する
+    template <class Kernel, class CharT, class OutputIter>
+    OutputIter
+    escape_run(const CharT* p, std::size_t n, OutputIter out) {
+      const CharT* const last = p + n;
+      const CharT* run = p;
+#if defined(__SSE2__)
+      if constexpr (sizeof(CharT) == 1) {
+        const __m128i zero = _mm_setzero_si128();
+        for (; last - p >= 16; p += 16) {
+          const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+          auto unsafe =
+            static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(Kernel::extra16(x), zero)))
+            ^ 0xffffu;
+          for (; unsafe != 0; unsafe &= unsafe - 1) {
+            const CharT* const q = p + __builtin_ctz(unsafe);
+            out = copy_run(run, q, out);
+            out = Kernel::write(*q, out);
+            run = q + 1;
+          }
+        }
+      }
+#endif
+      for (; p != last; ++p) {
+        if (Kernel::extra(code(*p)) != 0) {
+          out = copy_run(run, p, out);
+          out = Kernel::write(*p, out);
+          run = p + 1;
+        }
+      }
+      return copy_run(run, last, out);
+    }
+
+    template <class Fn>
+    decltype(auto)
+    dispatch(escape e, Fn fn) {
+      switch (e) {
+      case escape::html: return fn(html{});
+      case escape::json: return fn(json{});
+      case escape::url: return fn(url{});
+      default: return fn(shell{});
+      }
+    }
+  } // namespace _escape
+
+  // escaped_size
+  // s を e でエスケープした結果の長さ
+
+  template <class CharT, class ST>
+  std::size_t
+  escaped_size(escape e, std::basic_string_view<CharT, ST> s) noexcept {
+    if (e == escape::none)
+      return s.size();
+    const std::size_t quotes = e == escape::shell ? 2 : 0;
+    return s.size() + quotes + _escape::dispatch(e, [s]<class Kernel>(Kernel) {
+             return _escape::sum_extra<Kernel>(s.data(), s.size());
+           });
+  }
+
+  // escape_to
+  // s を e でエスケープして out に書き込む。escape_supported<CharT>(e) でなければならない
+
+  template <class CharT, class ST, class OutputIter>
+  OutputIter
+  escape_to(escape e, std::basic_string_view<CharT, ST> s, OutputIter out) {
+    if (e == escape::none)
+      return std::copy(s.begin(), s.end(), out);
+    if (e == escape::shell)
+      *out++ = static_cast<CharT>('\'');
+    out = _escape::dispatch(e, [s, out]<class Kernel>(Kernel) {
+      return _escape::escape_run<Kernel>(s.data(), s.size(), out);
+    });
+    if (e == escape::shell)
+      *out++ = static_cast<CharT>('\'');
+    return out;
+  }
+
+  template <class CharT, class ST>
+  std::basic_string<CharT, ST>
+  escaped(escape e, std::basic_string_view<CharT, ST> s) {
+    std::basic_string<CharT, ST> r(escaped_size(e, s), CharT());
+    escape_to(e, s, r.data());
+    return r;
+  }
+} // namespace strtpl
@@ -0,0 +1,38 @@
+/// @file fwd.hpp
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// <regex> を読み込まない軽量な宣言。
+// strtpl::compiled の関数は StrTpl::compiled ライブラリ (STRTPL_COMPILED) で定義しており、
+// 置換を行うだけの翻訳単位はこのヘッダだけを読み込めばよい
+
+namespace strtpl {
+
+  template <class CharT, class ST = std::char_traits<CharT>>
+  class basic_value_map;
+
+  using value_map = basic_value_map<char>;
+  using wvalue_map = basic_value_map<wchar_t>;
+  using u8value_map = basic_value_map<char8_t>;
+  using u16value_map = basic_value_map<char16_t>;
+  using u32value_map = basic_value_map<char32_t>;
+
+  namespace compiled {
+
+    // substitute
+    // strtpl::substitute, strtpl::wsubstitute と同じ置換を、ライブラリで一度だけ実体化したもので行う
+
+    std::string
+    substitute(std::string_view s,
+               const std::unordered_map<std::string_view, std::string_view>& map);
+    std::string
+    substitute(std::string_view s, const value_map& map);
+    std::wstring
+    substitute(std::wstring_view s,
+               const std::unordered_map<std::wstring_view, std::wstring_view>& map);
+    std::wstring
+    substitute(std::wstring_view s, const wvalue_map& map);
+  } // namespace compiled
+} // namespace strtpl
@@ -0,0 +1,133 @@
+/// @file generator.hpp
+#pragma once
+#include <coroutine>
+#include <exception> // std::exception_ptr, std::current_exception, std::rethrow_exception
+#include <iterator>  // std::default_sentinel_t, std::input_iterator_tag
+#include <memory>    // std::addressof
+#include <ranges>    // std::ranges::view_interface
+#include <utility>   // std::exchange
+
+namespace strtpl {
+
+  // generator
+  // co_yield した値を順に返す coroutine の戻り値型 (C++23 の std::generator の簡易版)。
+  // 移動のみ可能な input_range で、begin() と ++ のたびに次の co_yield まで実行を再開する。
+  // 値は coroutine の中の一時オブジェクトを参照するため、次に再開するまでだけ有効である。
+  // coroutine の中で送出された例外は begin() または ++ から再送出する
+
+  template <class T>
+  class generator : public std::ranges::view_interface<generator<T>> {
+  public:
+    struct promise_type {
+      const T* value_ = nullptr;
+      std::exception_ptr exception_{};
+
+      generator
+      get_return_object() noexcept {
+        return generator(std::coroutine_handle<promise_type>::from_promise(*this));
+      }
+      std::suspend_always
+      initial_suspend() const noexcept {
+        return {};
+      }
+      std::suspend_always
+      final_suspend() const noexcept {
+        return {};
+      }
+      std::suspend_always
+      yield_value(const T& value) noexcept {
+        value_ = std::addressof(value);
+        return {};
+      }
+      void
+      return_void() const noexcept {}
+      void
+      unhandled_exception() noexcept {
+        exception_ = std::current_exception();
+      }
+      // co_await は使えない
+      void await_transform() = delete;
+    };
+
+  private:
+    std::coroutine_handle<promise_type> handle_{};
+
+    explicit generator(std::coroutine_handle<promise_type> h) noexcept : handle_(h) {}
+
+    void
+    resume() const {
+      handle_.resume();
+      if (handle_.promise().exception_)
+        std::rethrow_exception(std::exchange(handle_.promise().exception_, nullptr));
+    }
+
+  public:
+    class iterator {
+    private:
+      const generator* parent_ = nullptr;
+
+      friend class generator;
+      explicit iterator(const generator& parent) noexcept : parent_(std::addressof(parent)) {}
+
+      bool
+      at_end() const noexcept {
+        return parent_->handle_.done();
+      }
+
+    public:
+      using iterator_concept = std::input_iterator_tag;
+      using value_type = T;
+      using difference_type = std::ptrdiff_t;
+
+      iterator() = default;
+      iterator(iterator&&) = default;
+      iterator& operator=(iterator&&) = default;
+
+      const T&
+      operator*() const noexcept {
+        return *parent_->handle_.promise().value_;
+      }
+      iterator&
+      operator++() {
+        parent_->resume();
+        return *this;
+      }
+      void
+      operator++(int) {
+        ++*this;
+      }
+
+      friend bool
+      operator==(const iterator& x, std::default_sentinel_t) noexcept {
+        return x.at_end();
+      }
+    };
+
+    generator() = default;
+    generator(generator&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    generator&
+    operator=(generator&& other) noexcept {
+      if (this != std::addressof(other)) {
+        if (handle_)
+          handle_.destroy();
+        handle_ = std::exchange(other.handle_, nullptr);
+      }
+      return *this;
+    }
+    ~generator() {
+      if (handle_)
+        handle_.destroy();
+    }
+
+    // 一度だけ呼び出せる
+    iterator
+    begin() {
+      resume();
+      return iterator(*this);
+    }
+    std::default_sentinel_t
+    end() const noexcept {
+      return {};
+    }
+  }; // class generator
+} // namespace strtpl
@@ -0,0 +1,151 @@
+/// @file identifier.hpp
+#pragma once
+#include <cstddef>     // std::size_t
+#include <iterator>    // std::iter_value_t
+#include <type_traits> // std::make_unsigned_t
+#include <vector>
+
+namespace strtpl {
+
+  // Unicode の文字型の placeholder の識別子の規則。
+  // ASCII は Python の string.Template と同じく [_a-zA-Z][_a-zA-Z0-9]* とし、ASCII 以外は
+  // XID_Start/XID_Continue の完全な表の代わりに、C1 制御文字、空白、句読点、記号、私用領域、
+  // サロゲート、非文字の主なブロックを除いた符号位置を (先頭か否かに関わらず) 識別子の文字とみなす。
+  // 正規表現では \p{ID_Start} と \p{ID_Continue} (nfa_regex.hpp) がこの規則による
+
+  namespace _identifier {
+    struct code_point_range {
+      char32_t lo;
+      char32_t hi;
+    };
+
+    // 識別子に含めない 0x80 以上の符号位置 (昇順)
+    inline constexpr code_point_range excluded[] = {
+      {0x0080, 0x00A9},   // C1 制御文字, NBSP, ¡ ¢ £ ¤ ¥ ¦ § ¨ ©
+      {0x00AB, 0x00B4},   // « ¬ SHY ® ¯ ° ± ² ³ ´
+      {0x00B6, 0x00B9},   // ¶ · ¸ ¹
+      {0x00BB, 0x00BF},   // » ¼ ½ ¾ ¿
+      {0x00D7, 0x00D7},   // ×
+      {0x00F7, 0x00F7},   // ÷
+      {0x037E, 0x037E},   // ギリシャ文字の疑問符
+      {0x0387, 0x0387},   // ギリシャ文字の中点
+      {0x1680, 0x1680},   // オガム文字の空白
+      {0x2000, 0x206F},   // 一般句読点 (空白、ゼロ幅の文字、ダッシュ、引用符など)
+      {0x20A0, 0x20CF},   // 通貨記号
+      {0x2190, 0x2BFF},   // 矢印、数学記号、技術記号、罫線、図形、その他の記号
+      {0x2E00, 0x2E7F},   // 補助句読点
+      {0x3000, 0x3004},   // 和字間隔、、。〃〄
+      {0x3008, 0x3020},   // 括弧、〒 など
+      {0x3030, 0x3030},   // 〰
+      {0x303D, 0x303F},   // 〽 など
+      {0x30A0, 0x30A0},   // ゠
+      {0x30FB, 0x30FB},   // ・
+      {0xD800, 0xF8FF},   // サロゲート、私用領域
+      {0xFD3E, 0xFD3F},   // 装飾括弧
+      {0xFE10, 0xFE1F},   // 縦書き形
+      {0xFE30, 0xFE6F},   // CJK 互換形、小字形
+      {0xFEFF, 0xFEFF},   // BOM
+      {0xFF00, 0xFF0F},   // 全角の ！ ＂ ＃ ＄ ％ ＆ ＇ （ ） ＊ ＋ ， － ． ／
+      {0xFF1A, 0xFF20},   // 全角の ： ； ＜ ＝ ＞ ？ ＠
+      {0xFF3B, 0xFF40},   // 全角の ［ ＼ ］ ＾ ＿ ｀
+      {0xFF5B, 0xFF65},   // 全角の ｛ ｜ ｝ ～ と半角の句読点
+      {0xFFE0, 0xFFFF},   // 全角の記号、特殊用途文字、非文字
+      {0x1F000, 0x1FAFF}, // 絵文字と記号
+      {0xE0000, 0xE00FF}, // タグ文字
+      {0xF0000, 0x10FFFF} // 補助私用領域
+    };
+
+    // 識別子の文字である 0x80 以上の符号位置の範囲 (excluded の補集合)
+    constexpr std::vector<code_point_range>
+    allowed() {
+      std::vector<code_point_range> r;
+      char32_t lo = 0x80;
+      for (const auto& x : excluded) {
+        if (x.lo > lo)
+          r.push_back({lo, x.lo - 1});
+        lo = x.hi + 1;
+      }
+      if (lo <= 0x10FFFF)
+        r.push_back({lo, 0x10FFFF});
+      return r;
+    }
+
+    // [first, last) の先頭の符号位置を、コード単位の大きさに応じて UTF-8, UTF-16, UTF-32 として
+    // 復号し、c に格納してコード単位の数を返す。不正な符号化 (冗長な符号化、サロゲートを含む) や
+    // 途中で終わる列では 0 を返す
+    template <class Iter, class Sentinel>
+    constexpr std::size_t
+    decode(Iter first, Sentinel last, char32_t& c) noexcept {
+      using CharT = std::iter_value_t<Iter>;
+      const auto unit = [](CharT x) {
+        return static_cast<char32_t>(static_cast<std::make_unsigned_t<CharT>>(x));
+      };
+      if (first == last)
+        return 0;
+      const char32_t c0 = unit(*first);
+      if constexpr (sizeof(CharT) == 1) {
+        std::size_t len;
+        char32_t min;
+        if (c0 < 0x80)
+          len = 1, c = c0, min = 0;
+        else if (c0 >= 0xC2 and c0 <= 0xDF)
+          len = 2, c = c0 & 0x1F, min = 0x80;
+        else if (c0 >= 0xE0 and c0 <= 0xEF)
+          len = 3, c = c0 & 0x0F, min = 0x800;
+        else if (c0 >= 0xF0 and c0 <= 0xF4)
+          len = 4, c = c0 & 0x07, min = 0x10000;
+        else
+          return 0;
+        for (std::size_t i = 1; i < len; ++i) {
+          if (++first == last or (unit(*first) & 0xC0) != 0x80)
+            return 0;
+          c = c << 6 | (unit(*first) & 0x3F);
+        }
+        if (c < min or c > 0x10FFFF or (c >= 0xD800 and c <= 0xDFFF))
+          return 0;
+        return len;
+      } else if constexpr (sizeof(CharT) == 2) {
+        if (c0 >= 0xDC00 and c0 <= 0xDFFF)
+          return 0;
+        if (c0 < 0xD800 or c0 > 0xDBFF) {
+          c = c0;
+          return 1;
+        }
+        if (++first == last or unit(*first) < 0xDC00 or unit(*first) > 0xDFFF)
+          return 0;
+        c = 0x10000 + ((c0 - 0xD800) << 10) + (unit(*first) - 0xDC00);
+        return 2;
+      } else {
+        if (c0 > 0x10FFFF or (c0 >= 0xD800 and c0 <= 0xDFFF))
+          return 0;
+        c = c0;
+        return 1;
+      }
+    }
+  } // namespace _identifier
+
+  // is_identifier_code_point
+  // ASCII 以外の符号位置 c が識別子の文字か
+
+  constexpr bool
+  is_identifier_code_point(char32_t c) noexcept {
+    if (c < 0x80 or c > 0x10FFFF)
+      return false;
+    for (const auto& x : _identifier::excluded)
+      if (c <= x.hi)
+        return c < x.lo;
+    return true;
+  }
+
+  // identifier_length
+  // [first, last) の先頭の ASCII 以外の文字が識別子の文字ならばそのコード単位の数を、
+  // そうでなければ (ASCII の文字や不正な符号化を含む) 0 を返す
+
+  template <class CharT>
+  constexpr std::size_t
+  identifier_length(const CharT* first, const CharT* last) noexcept {
+    char32_t c = 0;
+    const std::size_t n = _identifier::decode(first, last, c);
+    return n != 0 and is_identifier_code_point(c) ? n : 0;
+  }
+} // namespace strtpl
@@ -0,0 +1,299 @@
+/// @file instrumentation.hpp
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+#include <iterator> // std::output_iterator_tag
+#include <memory>   // std::addressof
+#include <vector>
+
+// STRTPL_INSTRUMENTATION
+// 1 のとき basic_string_template と regex_replace_fn が計数器を更新する。
+// 既定の 0 では STRTPL_INSTRUMENT_* マクロは何も生成せず、計測による実行時の負担は無い
+#ifndef STRTPL_INSTRUMENTATION
+#define STRTPL_INSTRUMENTATION 0
+#endif
+
+// STRTPL_INSTRUMENTATION_NAMESPACE
+// STRTPL_INSTRUMENTATION によって定義の変わる関数やクラスを置く inline namespace の名前。
+// 計測する翻訳単位としない翻訳単位が同じプログラムに混ざっても、両者の実体は異なる名前になり
+// ODR に違反しない (互いの実体を受け渡すことはできない)
+#if STRTPL_INSTRUMENTATION
+#define STRTPL_INSTRUMENTATION_NAMESPACE _instrumented
+#else
+#define STRTPL_INSTRUMENTATION_NAMESPACE _plain
+#endif
+
+namespace strtpl::instrumentation {
+
+  // render_stats
+  // 計数器の値。時間はナノ秒単位
+
+  struct render_stats {
+    // basic_string_template による置換の回数
+    std::uint64_t renders = 0;
+    // regex_replace_fn の呼び出し回数
+    std::uint64_t replacements = 0;
+    std::uint64_t matches = 0;
+    std::uint64_t input_bytes = 0;
+    std::uint64_t output_bytes = 0;
+    // 値に置き換えた placeholder の数
+    std::uint64_t placeholders = 0;
+    std::uint64_t missing_keys = 0;
+    std::uint64_t invalid_placeholders = 0;
+    // 結果の文字列の容量が変わった回数 (最初の確保を含む。他のヒープ確保は数えない)
+    std::uint64_t output_reallocations = 0;
+    std::uint64_t match_ns = 0;
+    std::uint64_t copy_ns = 0;
+
+    render_stats&
+    operator+=(const render_stats& x) noexcept;
+    friend render_stats
+    operator+(render_stats x, const render_stats& y) noexcept {
+      return x += y;
+    }
+    friend bool
+    operator==(const render_stats&, const render_stats&) = default;
+  }; // struct render_stats
+
+  enum class counter : std::size_t {
+    renders,
+    replacements,
+    matches,
+    input_bytes,
+    output_bytes,
+    placeholders,
+    missing_keys,
+    invalid_placeholders,
+    output_reallocations,
+    match_ns,
+    copy_ns,
+  };
+
+  inline constexpr std::array members{
+    &render_stats::renders,
+    &render_stats::replacements,
+    &render_stats::matches,
+    &render_stats::input_bytes,
+    &render_stats::output_bytes,
+    &render_stats::placeholders,
+    &render_stats::missing_keys,
+    &render_stats::invalid_placeholders,
+    &render_stats::output_reallocations,
+    &render_stats::match_ns,
+    &render_stats::copy_ns,
+  };
+
+  inline render_stats&
+  render_stats::operator+=(const render_stats& x) noexcept {
+    for (auto m : members)
+      this->*m += x.*m;
+    return *this;
+  }
+
+  // thread_counters
+  // スレッドごとの計数器。書き込むのは所有するスレッドだけなので、
+  // 更新は read-modify-write ではなく relaxed な load と store で行う。
+  // 一度確保したブロックは解放せず、スレッドの終了後は別のスレッドが再利用する
+
+  struct thread_counters {
+    std::array<std::atomic<std::uint64_t>, members.size()> values{};
+    std::atomic<bool> in_use{true};
+    thread_counters* next = nullptr;
+
+    render_stats
+    load() const noexcept {
+      render_stats r;
+      for (std::size_t i = 0; i < members.size(); ++i)
+        r.*members[i] = values[i].load(std::memory_order_relaxed);
+      return r;
+    }
+  };
+
+  struct registry {
+    std::atomic<thread_counters*> head{nullptr};
+    // 終了したスレッドの計数器の合計
+    std::array<std::atomic<std::uint64_t>, members.size()> retired{};
+
+    thread_counters*
+    acquire() {
+      for (auto p = head.load(std::memory_order_acquire); p != nullptr; p = p->next) {
+        bool expected = false;
+        if (p->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+          return p;
+      }
+      auto p = new thread_counters;
+      p->next = head.load(std::memory_order_relaxed);
+      while (not head.compare_exchange_weak(p->next, p, std::memory_order_release,
+                                            std::memory_order_relaxed)) {}
+      return p;
+    }
+
+    void
+    release(thread_counters* p) noexcept {
+      for (std::size_t i = 0; i < members.size(); ++i)
+        retired[i].fetch_add(p->values[i].exchange(0, std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+      p->in_use.store(false, std::memory_order_release);
+    }
+  }; // struct registry
+
+  inline registry&
+  global_registry() noexcept {
+    static registry r;
+    return r;
+  }
+
+  inline thread_counters&
+  local() {
+    thread_local struct handle {
+      thread_counters* p = global_registry().acquire();
+      handle() = default;
+      handle(const handle&) = delete;
+      handle& operator=(const handle&) = delete;
+      ~handle() {
+        global_registry().release(p);
+      }
+    } h;
+    return *h.p;
+  }
+
+  inline void
+  add(counter c, std::uint64_t n) {
+    auto& a = local().values[static_cast<std::size_t>(c)];
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  // snapshot
+  // 全てのスレッド (終了したものを含む) の合計。他のスレッドが更新中の値は含まれないことがある
+
+  inline render_stats
+  snapshot() {
+    auto& reg = global_registry();
+    render_stats r;
+    for (std::size_t i = 0; i < members.size(); ++i)
+      r.*members[i] = reg.retired[i].load(std::memory_order_relaxed);
+    for (auto p = reg.head.load(std::memory_order_acquire); p != nullptr; p = p->next)
+      r += p->load();
+    return r;
+  }
+
+  // thread_snapshot
+  // 呼び出したスレッドの値
+
+  inline render_stats
+  thread_snapshot() {
+    return local().load();
+  }
+
+  // thread_snapshots
+  // 実行中のスレッドごとの値
+
+  inline std::vector<render_stats>
+  thread_snapshots() {
+    std::vector<render_stats> r;
+    for (auto p = global_registry().head.load(std::memory_order_acquire); p != nullptr;
+         p = p->next)
+      if (p->in_use.load(std::memory_order_acquire))
+        r.push_back(p->load());
+    return r;
+  }
+
+  // phase_timer
+  // 経過時間を現在の区分の計数器に加えながら、区分を切り替える
+
+  class phase_timer {
+  private:
+    using clock = std::chrono::steady_clock;
+    counter current_;
+    clock::time_point start_ = clock::now();
+
+  public:
+    explicit phase_timer(counter c) noexcept : current_(c) {}
+    phase_timer(const phase_timer&) = delete;
+    phase_timer& operator=(const phase_timer&) = delete;
+    ~phase_timer() {
+      next(current_);
+    }
+
+    void
+    next(counter c) {
+      const auto now = clock::now();
+      add(current_, static_cast<std::uint64_t>(
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_).count()));
+      current_ = c;
+      start_ = now;
+    }
+  }; // class phase_timer
+
+  // counting_back_insert_iterator
+  // std::back_insert_iterator と同じく push_back し、容量が変わった回数を output_reallocations に加える
+
+  template <class String>
+  class counting_back_insert_iterator {
+  private:
+    String* s_;
+
+  public:
+    using iterator_category = std::output_iterator_tag;
+    using value_type = void;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = void;
+
+    explicit counting_back_insert_iterator(String& s) noexcept : s_(std::addressof(s)) {}
+
+    counting_back_insert_iterator&
+    operator=(typename String::value_type c) {
+      const auto cap = s_->capacity();
+      s_->push_back(c);
+      if (s_->capacity() != cap)
+        add(counter::output_reallocations, 1);
+      return *this;
+    }
+    counting_back_insert_iterator&
+    operator*() noexcept {
+      return *this;
+    }
+    counting_back_insert_iterator&
+    operator++() noexcept {
+      return *this;
+    }
+    counting_back_insert_iterator
+    operator++(int) noexcept {
+      return *this;
+    }
+  }; // class counting_back_insert_iterator
+
+  inline namespace STRTPL_INSTRUMENTATION_NAMESPACE {
+    // string_inserter
+    // 結果の文字列に書き込む出力イテレータ。計測が有効なときだけ容量の変化を数える
+
+    template <class String>
+    auto
+    string_inserter(String& s) {
+#if STRTPL_INSTRUMENTATION
+      return counting_back_insert_iterator<String>(s);
+#else
+      return std::back_inserter(s);
+#endif
+    }
+  } // namespace STRTPL_INSTRUMENTATION_NAMESPACE
+} // namespace strtpl::instrumentation
+
+#if STRTPL_INSTRUMENTATION
+#define STRTPL_INSTRUMENT_ADD(name, n)                                                             \
+  ::strtpl::instrumentation::add(::strtpl::instrumentation::counter::name,                         \
+                                 static_cast<std::uint64_t>(n))
+#define STRTPL_INSTRUMENT_PHASE_BEGIN(name)                                                        \
+  ::strtpl::instrumentation::phase_timer strtpl_phase_timer_(                                       \
+    ::strtpl::instrumentation::counter::name)
+#define STRTPL_INSTRUMENT_PHASE(name)                                                              \
+  strtpl_phase_timer_.next(::strtpl::instrumentation::counter::name)
+#else
+#define STRTPL_INSTRUMENT_ADD(name, n) static_cast<void>(0)
+#define STRTPL_INSTRUMENT_PHASE_BEGIN(name) static_cast<void>(0)
+#define STRTPL_INSTRUMENT_PHASE(name) static_cast<void>(0)
+#endif
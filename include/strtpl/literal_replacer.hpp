@@ -0,0 +1,242 @@
+/// @file literal_replacer.hpp
+#pragma once
+#include <algorithm>   // std::copy, std::max, std::min, std::ranges::lower_bound
+#include <array>
+#include <cstddef>     // std::size_t
+#include <cstdint>     // std::uint32_t
+#include <initializer_list>
+#include <iterator>    // std::back_inserter
+#include <limits>      // std::numeric_limits
+#include <ranges>      // std::ranges::input_range, std::views::reverse
+#include <stdexcept>   // std::invalid_argument
+#include <string>
+#include <string_view>
+#include <type_traits> // std::make_unsigned_t
+#include <utility>
+#include <vector>
+
+namespace strtpl {
+
+  // basic_literal_replacer
+  // needle と replacement の組から Aho-Corasick オートマトンを構築し、
+  // 入力の全ての needle を重ならないように leftmost-longest で置換する。
+  // オートマトンは needle を逆向きにしたものから作り、入力を区間ごとに後ろから走査して、
+  // 各位置から始まる最長の needle を求める (逆向きに読んだ文字列の接尾辞となる最長の needle)。
+  // その後で区間を先頭から辿り、一致を置換して needle の長さだけ進む。
+  // 区間の長さは最長の needle の長さ以上なので、区間の後ろを読む分を含めても各文字を読むのは
+  // 高々 2 回で、全体の手間は入力と出力の長さに対して線形である
+
+  template <class CharT, class ST = std::char_traits<CharT>>
+  class basic_literal_replacer {
+  public:
+    using value_type = CharT;
+    using traits_type = ST;
+    using string_view_type = std::basic_string_view<CharT, ST>;
+    using string_type = std::basic_string<CharT, ST>;
+
+  private:
+    using state_type = std::uint32_t;
+    using unsigned_char_type = std::make_unsigned_t<CharT>;
+    static constexpr state_type npos = std::numeric_limits<state_type>::max();
+    // 一度に走査する区間の最小の長さ
+    static constexpr std::size_t min_block = 1024;
+
+    struct pattern {
+      std::size_t needle_length;
+      std::size_t replacement_offset;
+      std::size_t replacement_length;
+    };
+
+    // 入力文字を等価クラスに写像し、遷移表の幅をアルファベットの大きさではなく
+    // needle に現れる文字の種類数に抑える。クラス 0 は needle に現れない文字。
+    std::array<state_type, 256> narrow_classes_{};
+    std::vector<std::pair<unsigned_char_type, state_type>> wide_classes_{};
+    std::size_t nclasses_ = 1;
+
+    // delta_[state * nclasses_ + class] が次の状態を表す平坦な遷移表
+    std::vector<state_type> delta_{};
+    // 状態で終わる最長の needle (無ければ npos)
+    std::vector<state_type> match_{};
+    // 最長の needle の長さ
+    std::size_t max_length_ = 0;
+    std::vector<pattern> patterns_{};
+    string_type replacements_{};
+
+    constexpr state_type
+    class_of(CharT c) const noexcept {
+      const auto u = static_cast<unsigned_char_type>(c);
+      if constexpr (sizeof(CharT) == 1) {
+        return narrow_classes_[u];
+      } else {
+        if (u < 256)
+          return narrow_classes_[u];
+        auto i = std::ranges::lower_bound(wide_classes_, u, {}, [](const auto& x) { return x.first; });
+        return i != wide_classes_.end() and i->first == u ? i->second : 0;
+      }
+    }
+
+    constexpr state_type&
+    assign_class(CharT c) {
+      const auto u = static_cast<unsigned_char_type>(c);
+      if (u < 256)
+        return narrow_classes_[u];
+      auto i = std::ranges::lower_bound(wide_classes_, u, {}, [](const auto& x) { return x.first; });
+      if (i == wide_classes_.end() or i->first != u)
+        i = wide_classes_.insert(i, {u, 0});
+      return i->second;
+    }
+
+    void
+    build(std::vector<std::pair<string_view_type, string_view_type>> pairs) {
+      for (const auto& [needle, replacement] : pairs) {
+        if (needle.empty())
+          throw std::invalid_argument("Error: empty needle");
+        for (CharT c : needle) {
+          auto& cls = assign_class(c);
+          if (cls == 0)
+            cls = static_cast<state_type>(nclasses_++);
+        }
+      }
+
+      // 逆向きの needle の trie を構築する。遷移先 0 は「未定義」を表す (根へ戻る遷移は存在しないため)
+      delta_.assign(nclasses_, 0);
+      match_.assign(1, npos);
+      for (const auto& [needle, replacement] : pairs) {
+        state_type s = 0;
+        for (CharT c : needle | std::views::reverse) {
+          auto& next = delta_[s * nclasses_ + class_of(c)];
+          if (next == 0) {
+            next = static_cast<state_type>(match_.size());
+            match_.push_back(npos);
+            delta_.resize(delta_.size() + nclasses_, 0);
+          }
+          s = delta_[s * nclasses_ + class_of(c)];
+        }
+        if (match_[s] != npos)
+          continue; // 重複した needle は最初のものを優先する
+        match_[s] = static_cast<state_type>(patterns_.size());
+        max_length_ = std::max(max_length_, needle.size());
+        patterns_.push_back({needle.size(), replacements_.size(), replacement.size()});
+        replacements_.append(replacement);
+      }
+
+      // 幅優先で failure link を辿り、遷移表を完全な DFA にする
+      const std::size_t nstates = match_.size();
+      std::vector<state_type> fail(nstates, 0);
+      std::vector<state_type> queue;
+      queue.reserve(nstates);
+      for (std::size_t c = 0; c < nclasses_; ++c)
+        if (const auto t = delta_[c]; t != 0)
+          queue.push_back(t);
+      for (std::size_t head = 0; head < queue.size(); ++head) {
+        const state_type s = queue[head];
+        // failure link 先は s より浅いため、その出力は確定済み。自身の needle の方が長い
+        if (match_[s] == npos)
+          match_[s] = match_[fail[s]];
+        for (std::size_t c = 0; c < nclasses_; ++c) {
+          auto& t = delta_[s * nclasses_ + c];
+          const auto f = delta_[fail[s] * nclasses_ + c];
+          if (t == 0) {
+            t = f;
+          } else {
+            fail[t] = f;
+            queue.push_back(t);
+          }
+        }
+      }
+    }
+
+  public:
+    basic_literal_replacer() = default;
+    basic_literal_replacer(std::initializer_list<std::pair<string_view_type, string_view_type>> il)
+      : basic_literal_replacer(std::views::all(il)) {}
+    // clang-format off
+    template <std::ranges::input_range Range>
+    requires requires(std::ranges::range_reference_t<Range> x) {
+      string_view_type(get<0>(x));
+      string_view_type(get<1>(x));
+    }
+    // clang-format on
+    explicit basic_literal_replacer(Range&& r) {
+      std::vector<std::pair<string_view_type, string_view_type>> pairs;
+      for (auto&& x : r)
+        pairs.emplace_back(string_view_type(get<0>(x)), string_view_type(get<1>(x)));
+      build(std::move(pairs));
+    }
+
+    std::size_t
+    size() const noexcept {
+      return patterns_.size();
+    }
+    bool
+    empty() const noexcept {
+      return patterns_.empty();
+    }
+
+    template <class OutputIter>
+    OutputIter
+    operator()(OutputIter out, string_view_type s) const {
+      if (patterns_.empty())
+        return std::copy(s.begin(), s.end(), out);
+
+      const CharT* const first = s.data();
+      const std::size_t n = s.size();
+      const std::size_t block = std::min(n, std::max(max_length_, min_block));
+      // longest[k - a] は位置 k から始まる最長の needle (無ければ npos)
+      std::vector<state_type> longest(block);
+      std::size_t copied = 0, i = 0;
+      while (i < n) {
+        // [a, e) の各位置について、その位置から最長の needle の長さだけ後ろまでを逆向きに読む
+        const std::size_t a = i;
+        const std::size_t e = std::min(n, a + block);
+        state_type state = 0;
+        for (std::size_t k = std::min(n, e + max_length_ - 1); k-- > a;) {
+          state = delta_[state * nclasses_ + class_of(first[k])];
+          if (k < e)
+            longest[k - a] = match_[state];
+        }
+        // 一致は区間の外まで続くことがあり、次の区間は一致の終わりから始める
+        while (i < e) {
+          const auto m = longest[i - a];
+          if (m == npos) {
+            ++i;
+            continue;
+          }
+          const auto& p = patterns_[m];
+          out = std::copy(first + copied, first + i, out);
+          const auto* r = replacements_.data() + p.replacement_offset;
+          out = std::copy(r, r + p.replacement_length, out);
+          copied = i += p.needle_length;
+        }
+      }
+      return std::copy(first + copied, first + n, out);
+    }
+
+    string_type
+    operator()(string_view_type s) const {
+      string_type r;
+      (*this)(std::back_inserter(r), s);
+      return r;
+    }
+  }; // class basic_literal_replacer
+
+  using literal_replacer = basic_literal_replacer<char>;
+  using wliteral_replacer = basic_literal_replacer<wchar_t>;
+
+  // literal_replace
+  // regex_replace_fn と同じ出力イテレータのインターフェイスを持つ
+
+  template <class OutputIter, class CharT, class ST>
+  OutputIter
+  literal_replace(OutputIter out, std::basic_string_view<CharT, ST> s,
+                  const basic_literal_replacer<CharT, ST>& replacer) {
+    return replacer(out, s);
+  }
+
+  template <class CharT, class ST>
+  std::basic_string<CharT, ST>
+  literal_replace(std::basic_string_view<CharT, ST> s,
+                  const basic_literal_replacer<CharT, ST>& replacer) {
+    return replacer(s);
+  }
+} // namespace strtpl
@@ -0,0 +1,220 @@
+/// @file literal_split.hpp
+#pragma once
+#include <algorithm> // std::min
+#include <cassert>
+#include <cstddef>   // std::size_t
+#include <iterator>  // std::forward_iterator_tag, std::input_iterator_tag
+#include <memory>    // std::addressof
+#include <ranges>    // std::ranges::view_interface
+#include <stdexcept> // std::invalid_argument
+#include <string>    // std::char_traits
+#include <string_view>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace strtpl {
+
+  // basic_literal_split_view
+  // 文字列を固定の区切り文字列で分割する view。regex::v2::regex_split と同じく、
+  // keepend ならば各部分文字列に区切りを含め、最後の区切りの後ろを最後の要素とし、
+  // 区切りが現れないときは empty view となる。
+  // 区切りの探索は char_traits::find (memchr など) に任せ、count() は一文字の区切りならば
+  // SIMD で数える。非 const の size() は最初の呼び出しで count() の結果を保持し、以後は
+  // 定数時間で返すので、非 const の view は sized_range となる (filter_view の begin() と同じく
+  // const の view には保持しない)。
+
+  template <class CharT, class ST = std::char_traits<CharT>>
+  class basic_literal_split_view
+    : public std::ranges::view_interface<basic_literal_split_view<CharT, ST>> {
+  public:
+    using string_view_type = std::basic_string_view<CharT, ST>;
+
+  private:
+    string_view_type base_{};
+    // 一文字の区切りは ch_ に保持し、delim_ は空にする
+    string_view_type delim_{};
+    CharT ch_{};
+    bool keepend_ = false;
+
+    static constexpr std::size_t npos = string_view_type::npos;
+
+    // size() が保持する要素の数。まだ数えていなければ npos
+    std::size_t count_ = npos;
+
+    constexpr std::size_t
+    delim_size() const noexcept {
+      return delim_.empty() ? 1 : delim_.size();
+    }
+
+    constexpr std::size_t
+    find(std::size_t pos) const noexcept {
+      if (delim_.empty()) {
+        if (pos >= base_.size())
+          return npos;
+        const CharT* p = ST::find(base_.data() + pos, base_.size() - pos, ch_);
+        return p == nullptr ? npos : static_cast<std::size_t>(p - base_.data());
+      }
+      return base_.find(delim_, pos);
+    }
+
+    static std::size_t
+    count_char(const CharT* p, std::size_t n, CharT c) noexcept {
+      std::size_t r = 0;
+#if defined(__SSE2__)
+      if constexpr (sizeof(CharT) == 1) {
+        // 一致した位置を 8 bit の計数器に足し込み、あふれる前に _mm_sad_epu8 で合計する
+        const __m128i v = _mm_set1_epi8(static_cast<char>(c));
+        const __m128i zero = _mm_setzero_si128();
+        while (n >= 16) {
+          __m128i acc = zero;
+          const std::size_t k = std::min<std::size_t>(n / 16, 255);
+          for (std::size_t i = 0; i < k; ++i, p += 16) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(x, v));
+          }
+          n -= k * 16;
+          const __m128i sum = _mm_sad_epu8(acc, zero);
+          r += static_cast<std::size_t>(_mm_cvtsi128_si32(sum))
+               + static_cast<std::size_t>(_mm_extract_epi16(sum, 4));
+        }
+      }
+#endif
+      for (; n != 0; ++p, --n)
+        r += ST::eq(*p, c) ? std::size_t{1} : std::size_t{0};
+      return r;
+    }
+
+  public:
+    class iterator {
+    private:
+      const basic_literal_split_view* parent_ = nullptr;
+      // 現在の要素の先頭と、それに続く区切りの位置 (最後の要素ならば npos)
+      std::size_t first_ = npos;
+      std::size_t next_ = npos;
+
+      friend class basic_literal_split_view;
+
+      constexpr iterator(const basic_literal_split_view& parent, std::size_t first,
+                         std::size_t next) noexcept
+        : parent_(std::addressof(parent)), first_(first), next_(next) {}
+
+    public:
+      using iterator_concept = std::forward_iterator_tag;
+      using iterator_category = std::input_iterator_tag;
+      using value_type = string_view_type;
+      using difference_type = std::ptrdiff_t;
+
+      iterator() = default;
+
+      constexpr string_view_type
+      operator*() const noexcept {
+        assert(first_ != npos);
+        const auto& s = parent_->base_;
+        if (next_ == npos)
+          return s.substr(first_);
+        return s.substr(first_, next_ - first_ + (parent_->keepend_ ? parent_->delim_size() : 0));
+      }
+
+      constexpr iterator&
+      operator++() noexcept {
+        assert(first_ != npos);
+        if (next_ == npos) {
+          first_ = npos;
+        } else {
+          first_ = next_ + parent_->delim_size();
+          next_ = parent_->find(first_);
+        }
+        return *this;
+      }
+      constexpr iterator
+      operator++(int) noexcept {
+        auto tmp = *this;
+        ++*this;
+        return tmp;
+      }
+
+      friend constexpr bool
+      operator==(const iterator& x, const iterator& y) noexcept {
+        return x.first_ == y.first_;
+      }
+    };
+
+    basic_literal_split_view() = default;
+    // 空の区切りは std::invalid_argument を送出する
+    constexpr basic_literal_split_view(string_view_type s, string_view_type delim,
+                                       bool keepend = false)
+      : base_(s), delim_(delim.size() == 1 ? string_view_type() : delim),
+        ch_(delim.size() == 1 ? delim[0] : CharT()), keepend_(keepend) {
+      if (delim.empty())
+        throw std::invalid_argument("Error: empty delimiter");
+    }
+    constexpr basic_literal_split_view(string_view_type s, CharT delim,
+                                       bool keepend = false) noexcept
+      : base_(s), ch_(delim), keepend_(keepend) {}
+
+    constexpr string_view_type
+    base() const noexcept {
+      return base_;
+    }
+    constexpr string_view_type
+    delimiter() const noexcept {
+      return delim_.empty() ? string_view_type(std::addressof(ch_), 1) : delim_;
+    }
+    constexpr bool
+    keepend() const noexcept {
+      return keepend_;
+    }
+
+    constexpr iterator
+    begin() const noexcept {
+      const auto next = find(0);
+      if (next == npos)
+        return end();
+      return {*this, 0, next};
+    }
+    constexpr iterator
+    end() const noexcept {
+      return {*this, npos, npos};
+    }
+
+    // 要素の数 (区切りの数 + 1, 区切りが無ければ 0)。呼び出すたびに入力全体を走査する
+    std::size_t
+    count() const noexcept {
+      std::size_t n = 0;
+      if (delim_.empty()) {
+        n = count_char(base_.data(), base_.size(), ch_);
+      } else {
+        for (auto i = find(0); i != npos; i = find(i + delim_.size()))
+          ++n;
+      }
+      return n == 0 ? 0 : n + 1;
+    }
+    // count() と同じ値。走査は最初の呼び出しだけで、結果は view とともにコピーされる
+    std::size_t
+    size() noexcept {
+      if (count_ == npos)
+        count_ = count();
+      return count_;
+    }
+  }; // class basic_literal_split_view
+
+  template <class CharT, class ST>
+  basic_literal_split_view(std::basic_string_view<CharT, ST>, std::basic_string_view<CharT, ST>,
+                           bool = false) -> basic_literal_split_view<CharT, ST>;
+
+  // literal_split
+
+  template <class CharT, class ST>
+  constexpr basic_literal_split_view<CharT, ST>
+  literal_split(std::basic_string_view<CharT, ST> s, std::basic_string_view<CharT, ST> delim,
+                bool keepend = false) {
+    return {s, delim, keepend};
+  }
+
+  template <class CharT, class ST>
+  constexpr basic_literal_split_view<CharT, ST>
+  literal_split(std::basic_string_view<CharT, ST> s, CharT delim, bool keepend = false) noexcept {
+    return {s, delim, keepend};
+  }
+} // namespace strtpl
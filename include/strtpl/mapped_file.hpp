@@ -0,0 +1,92 @@
+/// @file mapped_file.hpp
+#pragma once
+#include <cerrno>
+#include <cstddef> // std::byte, std::size_t
+#include <span>
+#include <string>
+#include <system_error> // std::system_error, std::generic_category
+#include <utility>      // std::exchange
+#include <fcntl.h>      // ::open
+#include <sys/mman.h>   // ::mmap, ::munmap
+#include <sys/stat.h>   // ::fstat
+#include <unistd.h>     // ::close
+
+namespace strtpl {
+
+  // mapped_file
+  // 読み取り専用でファイル全体を mmap する。移動のみ可能で、破棄するときに munmap する。
+  // 空のファイルは mmap せず、bytes() は空の span を返す。
+  // mmap した領域はページ境界に揃うため、basic_template_view::from_bytes などに直接渡せる
+
+  class mapped_file {
+  private:
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+
+    [[noreturn]] static void
+    fail(const std::string& what) {
+      throw std::system_error(errno, std::generic_category(), what);
+    }
+
+  public:
+    mapped_file() = default;
+    explicit mapped_file(const std::string& path) {
+      const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0)
+        fail("open: " + path);
+      struct ::stat st {};
+      if (::fstat(fd, &st) != 0) {
+        const int e = errno;
+        ::close(fd);
+        errno = e;
+        fail("fstat: " + path);
+      }
+      size_ = static_cast<std::size_t>(st.st_size);
+      if (size_ != 0) {
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+          const int e = errno;
+          ::close(fd);
+          errno = e;
+          fail("mmap: " + path);
+        }
+        data_ = p;
+      }
+      ::close(fd);
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    mapped_file(mapped_file&& other) noexcept
+      : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+    mapped_file&
+    operator=(mapped_file&& other) noexcept {
+      if (this != &other) {
+        reset();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+      }
+      return *this;
+    }
+    ~mapped_file() {
+      reset();
+    }
+
+    void
+    reset() noexcept {
+      if (data_ != nullptr)
+        ::munmap(data_, size_);
+      data_ = nullptr;
+      size_ = 0;
+    }
+
+    std::span<const std::byte>
+    bytes() const noexcept {
+      return {static_cast<const std::byte*>(data_), data_ == nullptr ? 0 : size_};
+    }
+    std::size_t
+    size() const noexcept {
+      return size_;
+    }
+  }; // class mapped_file
+} // namespace strtpl
@@ -0,0 +1,735 @@
+/// @file nfa_regex.hpp
+#pragma once
+#include <algorithm> // std::copy, std::fill, std::find
+#include <cstddef>   // std::ptrdiff_t, std::size_t
+#include <cstdint>   // std::int32_t, std::int64_t, std::uint32_t
+#include <iterator>  // std::iterator_traits
+#include <limits>    // std::numeric_limits
+#include <ranges>    // std::ranges::next
+#include <regex>     // std::regex_error, std::regex_constants
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits> // std::make_unsigned_t
+#include <utility>
+#include <vector>
+#include <strtpl/identifier.hpp>
+#include <strtpl/regex_engine.hpp>
+
+namespace strtpl {
+
+  // nfa_program
+  // 正規表現を Thompson 構成で変換した命令列。Pike VM で実行するため、
+  // 実行時間は入力長と命令数の積で抑えられ、入力に依存してスタックを消費することもない。
+  // 対応する構文は ECMAScript の部分集合で、リテラル、
+  // エスケープ (\d \w \s \D \W \S \xhh \uhhhh \u{h...} など)、'.', 文字クラス,
+  // グループ ((...) と (?:...)), 選択 '|', 量指定子 (* + ? とその最短版), ^ $ である。
+  // 照合はコード単位ごとに行うが、\p{ID_Start} と \p{ID_Continue} (identifier.hpp の識別子の規則)
+  // だけは、コード単位の大きさに応じて UTF-8, UTF-16, UTF-32 として復号した一つの符号位置に一致する。
+
+  enum class nfa_op : std::uint8_t {
+    char_,  // c と一致する 1 文字
+    class_, // ranges[x, x + y) のいずれかに含まれる 1 文字 (c != 0 ならば否定)
+    // ranges[x, x + y) のいずれかに含まれる符号位置を符号化した列の先頭。後に続く c 個の
+    // 任意の 1 文字のうち、列の残りの長さの分だけを読むように分岐する
+    code_point_class,
+    split,  // pc + x と pc + y へ分岐 (x を優先)
+    jmp,    // pc + x へ移動
+    save,   // 捕捉位置 c に現在位置を記録
+    bol,    // 入力の先頭
+    eol,    // 入力の末尾
+    match,
+  };
+
+  struct nfa_inst {
+    nfa_op op = nfa_op::match;
+    std::uint32_t c = 0;
+    std::int32_t x = 0;
+    std::int32_t y = 0;
+  };
+
+  struct nfa_range {
+    std::uint32_t lo = 0;
+    std::uint32_t hi = 0;
+  };
+
+  struct nfa_program {
+    std::vector<nfa_inst> insts{};
+    std::vector<nfa_range> ranges{};
+    std::size_t mark_count = 0;
+  };
+
+  // nfa_compile
+
+  template <class CharT>
+  struct nfa_compiler {
+  private:
+    using unsigned_char_type = std::make_unsigned_t<CharT>;
+    using fragment = std::vector<nfa_inst>;
+    static constexpr std::uint32_t max_char = std::numeric_limits<unsigned_char_type>::max();
+    // 一つの符号位置を符号化したコード単位の数の最大値
+    static constexpr std::uint32_t max_units = sizeof(CharT) == 1 ? 4 : sizeof(CharT) == 2 ? 2 : 1;
+
+    std::basic_string_view<CharT> pattern_;
+    std::size_t pos_ = 0;
+    nfa_program prog_{};
+
+    static constexpr std::uint32_t
+    code(CharT c) noexcept {
+      return static_cast<std::uint32_t>(static_cast<unsigned_char_type>(c));
+    }
+
+    constexpr bool
+    eof() const noexcept {
+      return pos_ == pattern_.size();
+    }
+    constexpr bool
+    peek(char c) const noexcept {
+      return not eof() and pattern_[pos_] == CharT(c);
+    }
+    constexpr bool
+    consume(char c) noexcept {
+      if (not peek(c))
+        return false;
+      ++pos_;
+      return true;
+    }
+
+    static constexpr void
+    append(fragment& f, const fragment& g) {
+      f.insert(f.end(), g.begin(), g.end());
+    }
+    static constexpr std::int32_t
+    offset(std::size_t n) noexcept {
+      return static_cast<std::int32_t>(n);
+    }
+
+    constexpr fragment
+    char_class(std::vector<nfa_range> ranges, bool negate) {
+      const auto first = prog_.ranges.size();
+      prog_.ranges.insert(prog_.ranges.end(), ranges.begin(), ranges.end());
+      return {{nfa_op::class_, negate ? 1u : 0u, offset(first), offset(ranges.size())}};
+    }
+
+    // \d \w \s とその否定を範囲の集合として返す
+    static constexpr bool
+    class_escape(CharT c, std::vector<nfa_range>& ranges, bool& negate) {
+      switch (code(c)) {
+      case 'D':
+        negate = true;
+        [[fallthrough]];
+      case 'd':
+        ranges.push_back({'0', '9'});
+        return true;
+      case 'W':
+        negate = true;
+        [[fallthrough]];
+      case 'w':
+        ranges.push_back({'0', '9'});
+        ranges.push_back({'A', 'Z'});
+        ranges.push_back({'_', '_'});
+        ranges.push_back({'a', 'z'});
+        return true;
+      case 'S':
+        negate = true;
+        [[fallthrough]];
+      case 's':
+        ranges.push_back({'\t', '\r'});
+        ranges.push_back({' ', ' '});
+        return true;
+      default:
+        return false;
+      }
+    }
+
+    static constexpr std::vector<nfa_range>
+    complement(std::vector<nfa_range> ranges) {
+      std::ranges::sort(ranges, {}, &nfa_range::lo);
+      std::vector<nfa_range> r;
+      std::uint32_t lo = 0;
+      bool done = false;
+      for (const auto& x : ranges) {
+        if (x.lo > lo)
+          r.push_back({lo, x.lo - 1});
+        if (x.hi >= max_char) {
+          done = true;
+          break;
+        }
+        lo = std::max(lo, x.hi + 1);
+      }
+      if (not done)
+        r.push_back({lo, max_char});
+      return r;
+    }
+
+    // \p{ID_Start} と \p{ID_Continue} ('\\p' の後から)
+    constexpr fragment
+    property() {
+      if (not consume('{'))
+        throw std::regex_error(std::regex_constants::error_escape);
+      const auto first = pos_;
+      while (not eof() and not peek('}'))
+        ++pos_;
+      if (eof())
+        throw std::regex_error(std::regex_constants::error_escape);
+      const auto name = pattern_.substr(first, pos_++ - first);
+      const auto is = [name](std::string_view s) {
+        return std::ranges::equal(name, s, {}, code, [](char c) { return std::uint32_t(c); });
+      };
+      std::vector<nfa_range> ranges;
+      if (is("ID_Continue"))
+        ranges.push_back({'0', '9'});
+      else if (not is("ID_Start"))
+        throw std::regex_error(std::regex_constants::error_escape);
+      ranges.push_back({'A', 'Z'});
+      ranges.push_back({'_', '_'});
+      ranges.push_back({'a', 'z'});
+      for (const auto& x : _identifier::allowed())
+        ranges.push_back({x.lo, x.hi});
+      if constexpr (max_units == 1) {
+        return char_class(std::move(ranges), false);
+      } else {
+        fragment f = char_class(std::move(ranges), false);
+        f[0].op = nfa_op::code_point_class;
+        f[0].c = max_units - 1;
+        // 否定した空の範囲の集合は任意の 1 文字に一致する
+        for (std::uint32_t i = 1; i < max_units; ++i)
+          f.push_back({nfa_op::class_, 1u, f[0].x, 0});
+        return f;
+      }
+    }
+
+    // 16 進数の数字を n 個まで読む (n 個ちょうどでなければならないとき exact)
+    constexpr std::uint32_t
+    hex_digits(std::size_t n, bool exact) {
+      std::uint32_t v = 0;
+      std::size_t i = 0;
+      for (; i < n and not eof(); ++i, ++pos_) {
+        const auto c = code(pattern_[pos_]);
+        std::uint32_t d;
+        if ('0' <= c and c <= '9')
+          d = c - '0';
+        else if ('a' <= c and c <= 'f')
+          d = c - 'a' + 10;
+        else if ('A' <= c and c <= 'F')
+          d = c - 'A' + 10;
+        else
+          break;
+        v = v * 16 + d;
+      }
+      if (i == 0 or (exact and i != n))
+        throw std::regex_error(std::regex_constants::error_escape);
+      return v;
+    }
+
+    constexpr std::uint32_t
+    escape_char() {
+      if (eof())
+        throw std::regex_error(std::regex_constants::error_escape);
+      const CharT c = pattern_[pos_++];
+      switch (code(c)) {
+      case 'x':
+        return hex_digits(2, true);
+      case 'u':
+        // \uhhhh または \u{h...} (符号位置)
+        if (consume('{')) {
+          const auto v = hex_digits(6, false);
+          if (v > 0x10ffff or not consume('}'))
+            throw std::regex_error(std::regex_constants::error_escape);
+          return v;
+        }
+        return hex_digits(4, true);
+      case 'n':
+        return '\n';
+      case 'r':
+        return '\r';
+      case 't':
+        return '\t';
+      case 'v':
+        return '\v';
+      case 'f':
+        return '\f';
+      case '0':
+        return 0;
+      default:
+        if (('0' <= code(c) and code(c) <= '9') or ('a' <= code(c) and code(c) <= 'z')
+            or ('A' <= code(c) and code(c) <= 'Z'))
+          throw std::regex_error(std::regex_constants::error_escape);
+        return code(c);
+      }
+    }
+
+    constexpr fragment
+    bracket() {
+      const bool negate = consume('^');
+      std::vector<nfa_range> ranges;
+      while (true) {
+        if (eof())
+          throw std::regex_error(std::regex_constants::error_brack);
+        if (peek(']'))
+          break;
+        std::uint32_t lo;
+        if (consume('\\')) {
+          bool neg = false;
+          std::vector<nfa_range> esc;
+          if (not eof() and class_escape(pattern_[pos_], esc, neg)) {
+            ++pos_;
+            if (neg)
+              esc = complement(std::move(esc));
+            ranges.insert(ranges.end(), esc.begin(), esc.end());
+            continue;
+          }
+          lo = escape_char();
+        } else {
+          lo = code(pattern_[pos_++]);
+        }
+        std::uint32_t hi = lo;
+        if (peek('-') and pos_ + 1 < pattern_.size() and pattern_[pos_ + 1] != CharT(']')) {
+          ++pos_;
+          hi = consume('\\') ? escape_char() : code(pattern_[pos_++]);
+          if (hi < lo)
+            throw std::regex_error(std::regex_constants::error_range);
+        }
+        ranges.push_back({lo, hi});
+      }
+      ++pos_; // ']'
+      return char_class(std::move(ranges), negate);
+    }
+
+    constexpr fragment
+    atom() {
+      const CharT c = pattern_[pos_++];
+      switch (code(c)) {
+      case '(': {
+        fragment f;
+        if (consume('?')) {
+          if (not consume(':'))
+            throw std::regex_error(std::regex_constants::error_paren);
+          f = alternative();
+        } else {
+          const auto n = static_cast<std::uint32_t>(++prog_.mark_count);
+          f.push_back({nfa_op::save, 2 * n});
+          append(f, alternative());
+          f.push_back({nfa_op::save, 2 * n + 1});
+        }
+        if (not consume(')'))
+          throw std::regex_error(std::regex_constants::error_paren);
+        return f;
+      }
+      case ')':
+        throw std::regex_error(std::regex_constants::error_paren);
+      case '[':
+        return bracket();
+      case '.':
+        return char_class({{'\n', '\n'}, {'\r', '\r'}}, true);
+      case '^':
+        return {{nfa_op::bol}};
+      case '$':
+        return {{nfa_op::eol}};
+      case '*':
+      case '+':
+      case '?':
+        throw std::regex_error(std::regex_constants::error_badrepeat);
+      case '{':
+        throw std::regex_error(std::regex_constants::error_brace);
+      case '\\': {
+        if (consume('p'))
+          return property();
+        bool negate = false;
+        std::vector<nfa_range> ranges;
+        if (not eof() and class_escape(pattern_[pos_], ranges, negate)) {
+          ++pos_;
+          return char_class(std::move(ranges), negate);
+        }
+        return {{nfa_op::char_, escape_char()}};
+      }
+      default:
+        return {{nfa_op::char_, code(c)}};
+      }
+    }
+
+    constexpr fragment
+    repeat() {
+      fragment e = atom();
+      while (not eof()) {
+        const CharT q = pattern_[pos_];
+        if (q != CharT('*') and q != CharT('+') and q != CharT('?'))
+          break;
+        ++pos_;
+        const bool greedy = not consume('?');
+        const auto n = offset(e.size());
+        const auto branch = [greedy](std::int32_t go, std::int32_t skip) {
+          return greedy ? nfa_inst{nfa_op::split, 0, go, skip} : nfa_inst{nfa_op::split, 0, skip, go};
+        };
+        fragment f;
+        if (q == CharT('*')) {
+          // L1: split L2, L3; L2: e; jmp L1; L3:
+          f.push_back(branch(1, n + 2));
+          append(f, e);
+          f.push_back({nfa_op::jmp, 0, -(n + 1)});
+        } else if (q == CharT('+')) {
+          // L1: e; split L1, L3; L3:
+          f = e;
+          f.push_back(branch(-n, 1));
+        } else {
+          // split L1, L2; L1: e; L2:
+          f.push_back(branch(1, n + 1));
+          append(f, e);
+        }
+        e = std::move(f);
+      }
+      return e;
+    }
+
+    constexpr fragment
+    sequence() {
+      fragment f;
+      while (not eof() and not peek('|') and not peek(')'))
+        append(f, repeat());
+      return f;
+    }
+
+    constexpr fragment
+    alternative() {
+      fragment f = sequence();
+      while (consume('|')) {
+        fragment g = sequence();
+        // split L1, L2; L1: f; jmp L3; L2: g; L3:
+        fragment h;
+        h.push_back({nfa_op::split, 0, 1, offset(f.size()) + 2});
+        append(h, f);
+        h.push_back({nfa_op::jmp, 0, offset(g.size()) + 1});
+        append(h, g);
+        f = std::move(h);
+      }
+      return f;
+    }
+
+  public:
+    constexpr explicit nfa_compiler(std::basic_string_view<CharT> pattern) : pattern_(pattern) {}
+
+    constexpr nfa_program
+    compile() && {
+      fragment f = alternative();
+      if (not eof())
+        throw std::regex_error(std::regex_constants::error_paren);
+      prog_.insts.push_back({nfa_op::save, 0});
+      append(prog_.insts, f);
+      prog_.insts.push_back({nfa_op::save, 1});
+      prog_.insts.push_back({nfa_op::match});
+      return std::move(prog_);
+    }
+  }; // struct nfa_compiler
+
+  template <class CharT>
+  constexpr nfa_program
+  nfa_compile(std::basic_string_view<CharT> pattern) {
+    return nfa_compiler<CharT>(pattern).compile();
+  }
+
+  // nfa_nesting_depth
+  // pattern のグループの入れ子の最大の深さ。nfa_compile はグループごとに再帰するため、
+  // 信頼できない pattern を変換する前に深さを制限するのに使う
+
+  template <class CharT>
+  constexpr std::size_t
+  nfa_nesting_depth(std::basic_string_view<CharT> pattern) noexcept {
+    std::size_t depth = 0, r = 0;
+    bool bracket = false;
+    for (std::size_t i = 0; i < pattern.size(); ++i) {
+      const CharT c = pattern[i];
+      if (c == CharT('\\'))
+        ++i;
+      else if (bracket)
+        bracket = c != CharT(']');
+      else if (c == CharT('['))
+        bracket = true;
+      else if (c == CharT('('))
+        r = std::max(r, ++depth);
+      else if (c == CharT(')') and depth != 0)
+        --depth;
+    }
+    return r;
+  }
+
+  // nfa_execute
+
+  struct nfa_stack_entry {
+    std::uint32_t pc = 0;
+    std::uint32_t slot = 0; // 0 以外ならば捕捉位置 slot - 1 を value に戻す
+    std::ptrdiff_t value = 0;
+  };
+
+  // Pike VM の作業領域。命令数を n, 捕捉位置の数を m とすると
+  // dense, sparse は 2 * n, caps は 2 * n * m, tmp は m, stack は 2 * n + 1 の大きさが必要
+  struct nfa_scratch {
+    std::uint32_t* dense;
+    std::uint32_t* sparse;
+    std::ptrdiff_t* caps;
+    std::ptrdiff_t* tmp;
+    nfa_stack_entry* stack;
+  };
+
+  // nfa_workspace
+  // nfa_scratch の領域を持ち、照合のたびに確保しないように使い回す
+
+  struct nfa_workspace {
+    std::vector<std::uint32_t> sets{};
+    std::vector<std::ptrdiff_t> caps{};
+    std::vector<nfa_stack_entry> stack{};
+
+    // 命令数 n, 捕捉位置の数 m の照合に足りる大きさにする (足りていれば確保しない)
+    nfa_scratch
+    prepare(std::size_t n, std::size_t m) {
+      if (sets.size() < 4 * n)
+        sets.resize(4 * n);
+      if (caps.size() < (2 * n + 1) * m)
+        caps.resize((2 * n + 1) * m);
+      if (stack.size() < 2 * n + 1)
+        stack.resize(2 * n + 1);
+      return {sets.data(), sets.data() + 2 * n, caps.data(), caps.data() + 2 * n * m,
+              stack.data()};
+    }
+  };
+
+  // nfa_budget
+  // 照合の手間の上限。入力の各位置で処理するスレッドの数を remaining から引き、足りなくなれば
+  // 照合を打ち切って exhausted を立てる (一致しなかったものとして扱う)
+
+  struct nfa_budget {
+    std::size_t remaining = 0;
+    bool exhausted = false;
+  };
+
+  // 先頭の一致で必ず読まれる文字。存在すれば探索の開始位置を読み飛ばすのに使う
+  constexpr bool
+  nfa_first_char(std::span<const nfa_inst> insts, std::uint32_t& c) noexcept {
+    for (const auto& in : insts) {
+      if (in.op == nfa_op::save)
+        continue;
+      c = in.c;
+      return in.op == nfa_op::char_;
+    }
+    return false;
+  }
+
+  template <class BiIter>
+  constexpr bool
+  nfa_execute(std::span<const nfa_inst> insts, std::span<const nfa_range> ranges,
+              nfa_scratch sc, BiIter first, BiIter last, std::ptrdiff_t pos,
+              std::span<std::ptrdiff_t> caps, std::regex_constants::match_flag_type flags,
+              nfa_budget* budget = nullptr) {
+    using CharT = typename std::iterator_traits<BiIter>::value_type;
+    using unsigned_char_type = std::make_unsigned_t<CharT>;
+    const std::size_t n = insts.size();
+    const std::size_t m = caps.size();
+    const bool not_null = flags & std::regex_constants::match_not_null;
+    const bool continuous = flags & std::regex_constants::match_continuous;
+    const bool not_bol = flags & std::regex_constants::match_not_bol;
+    const bool not_eol = flags & std::regex_constants::match_not_eol;
+    std::uint32_t first_char = 0;
+    const bool has_first_char = nfa_first_char(insts, first_char);
+
+    std::uint32_t* dense[2] = {sc.dense, sc.dense + n};
+    std::uint32_t* sparse[2] = {sc.sparse, sc.sparse + n};
+    std::ptrdiff_t* tcaps[2] = {sc.caps, sc.caps + n * m};
+    std::size_t size[2] = {0, 0};
+
+    const auto contains = [&](int k, std::uint32_t pc) {
+      return sparse[k][pc] < size[k] and dense[k][sparse[k][pc]] == pc;
+    };
+    const auto add = [&](int k, std::uint32_t pc0, const std::ptrdiff_t* src, std::ptrdiff_t off,
+                         bool at_end) {
+      std::copy(src, src + m, sc.tmp);
+      std::size_t top = 0;
+      sc.stack[top++] = {pc0, 0, 0};
+      while (top != 0) {
+        const auto e = sc.stack[--top];
+        if (e.slot != 0) {
+          sc.tmp[e.slot - 1] = e.value;
+          continue;
+        }
+        const std::uint32_t pc = e.pc;
+        if (contains(k, pc))
+          continue;
+        sparse[k][pc] = static_cast<std::uint32_t>(size[k]);
+        dense[k][size[k]++] = pc;
+        const auto& in = insts[pc];
+        const auto jump = [pc](std::int32_t d) {
+          return static_cast<std::uint32_t>(static_cast<std::int64_t>(pc) + d);
+        };
+        switch (in.op) {
+        case nfa_op::jmp:
+          sc.stack[top++] = {jump(in.x), 0, 0};
+          break;
+        case nfa_op::split:
+          sc.stack[top++] = {jump(in.y), 0, 0};
+          sc.stack[top++] = {jump(in.x), 0, 0};
+          break;
+        case nfa_op::save:
+          sc.stack[top++] = {0, in.c + 1, sc.tmp[in.c]};
+          sc.tmp[in.c] = off;
+          sc.stack[top++] = {pc + 1, 0, 0};
+          break;
+        case nfa_op::bol:
+          if (off == 0 and not not_bol)
+            sc.stack[top++] = {pc + 1, 0, 0};
+          break;
+        case nfa_op::eol:
+          if (at_end and not not_eol)
+            sc.stack[top++] = {pc + 1, 0, 0};
+          break;
+        default:
+          std::copy(sc.tmp, sc.tmp + m, tcaps[k] + pc * m);
+          break;
+        }
+      }
+    };
+    const auto in_ranges = [ranges](const nfa_inst& in, std::uint32_t c) {
+      for (const auto& x : ranges.subspan(static_cast<std::size_t>(in.x),
+                                          static_cast<std::size_t>(in.y)))
+        if (x.lo <= c and c <= x.hi)
+          return true;
+      return false;
+    };
+
+    std::fill(caps.begin(), caps.end(), -1);
+    bool matched = false;
+    int k = 0;
+    BiIter it = std::ranges::next(first, pos);
+    std::ptrdiff_t off = pos;
+    while (true) {
+      bool at_end = it == last;
+      if (not matched and (off == pos or not continuous)) {
+        if (size[k] == 0 and has_first_char and not continuous) {
+          // 実行中のスレッドが無ければ、先頭の文字が現れる位置まで読み飛ばす
+          while (it != last and static_cast<unsigned_char_type>(*it) != first_char) {
+            ++it;
+            ++off;
+          }
+          at_end = it == last;
+          if (at_end)
+            break;
+        }
+        add(k, 0, caps.data(), off, at_end);
+      }
+      if (size[k] == 0)
+        break;
+      if (budget != nullptr) {
+        if (budget->remaining < size[k]) {
+          budget->remaining = 0;
+          budget->exhausted = true;
+          return false;
+        }
+        budget->remaining -= size[k];
+      }
+      const int l = 1 - k;
+      size[l] = 0;
+      const std::uint32_t c = at_end ? 0 : static_cast<unsigned_char_type>(*it);
+      const bool next_at_end = at_end or std::ranges::next(it) == last;
+      for (std::size_t i = 0; i < size[k]; ++i) {
+        const std::uint32_t pc = dense[k][i];
+        const auto& in = insts[pc];
+        const std::ptrdiff_t* t = tcaps[k] + pc * m;
+        if (in.op == nfa_op::match) {
+          if (not_null and t[0] == off)
+            continue;
+          std::copy(t, t + m, caps.begin());
+          matched = true;
+          break; // 優先度の低いスレッドは捨てる
+        }
+        if (at_end)
+          continue;
+        if ((in.op == nfa_op::char_ and in.c == c)
+            or (in.op == nfa_op::class_ and in_ranges(in, c) != (in.c != 0))) {
+          add(l, pc + 1, t, off + 1, next_at_end);
+        } else if (in.op == nfa_op::code_point_class) {
+          // 列の残りの len - 1 個のコード単位は後に続く任意の 1 文字で読む
+          char32_t u = 0;
+          const std::size_t len = _identifier::decode(it, last, u);
+          if (len != 0 and in_ranges(in, u))
+            add(l, pc + 2 + in.c - static_cast<std::uint32_t>(len), t, off + 1, next_at_end);
+        }
+      }
+      if (at_end)
+        break;
+      k = l;
+      ++it;
+      ++off;
+    }
+    return matched;
+  }
+
+  // basic_nfa_regex
+  // regex_engine を満たす線形時間の正規表現。
+  // search_from と match_at は最後に nfa_workspace を受け取る多重定義を持ち、engine_iterator は
+  // 一つの nfa_workspace を一致ごとに使い回す (受け取らないものは照合のたびに確保する)
+
+  template <class CharT>
+  class basic_nfa_regex {
+  public:
+    using value_type = CharT;
+    using workspace_type = nfa_workspace;
+
+  private:
+    nfa_program prog_{};
+
+  public:
+    basic_nfa_regex() : prog_(nfa_compile(std::basic_string_view<CharT>())) {}
+    template <class ST>
+    explicit basic_nfa_regex(std::basic_string_view<CharT, ST> pattern)
+      : prog_(nfa_compile(std::basic_string_view<CharT>(pattern.data(), pattern.size()))) {}
+    template <class ST, class Allocator>
+    explicit basic_nfa_regex(const std::basic_string<CharT, ST, Allocator>& pattern)
+      : basic_nfa_regex(std::basic_string_view<CharT, ST>(pattern)) {}
+    explicit basic_nfa_regex(const CharT* pattern)
+      : basic_nfa_regex(std::basic_string_view<CharT>(pattern)) {}
+
+    std::size_t
+    mark_count() const noexcept {
+      return prog_.mark_count;
+    }
+    const nfa_program&
+    program() const noexcept {
+      return prog_;
+    }
+
+    template <class BiIter>
+    bool
+    search_from(BiIter first, BiIter last, std::ptrdiff_t pos, std::span<std::ptrdiff_t> caps,
+                std::regex_constants::match_flag_type flags, nfa_workspace& ws) const {
+      return nfa_execute(std::span<const nfa_inst>(prog_.insts),
+                         std::span<const nfa_range>(prog_.ranges),
+                         ws.prepare(prog_.insts.size(), caps.size()), first, last, pos, caps,
+                         flags);
+    }
+    template <class BiIter>
+    bool
+    search_from(BiIter first, BiIter last, std::ptrdiff_t pos, std::span<std::ptrdiff_t> caps,
+                std::regex_constants::match_flag_type flags =
+                  std::regex_constants::match_default) const {
+      nfa_workspace ws;
+      return search_from(first, last, pos, caps, flags, ws);
+    }
+    template <class BiIter>
+    bool
+    match_at(BiIter first, BiIter last, std::ptrdiff_t pos, std::span<std::ptrdiff_t> caps,
+             std::regex_constants::match_flag_type flags, nfa_workspace& ws) const {
+      return search_from(first, last, pos, caps, flags | std::regex_constants::match_continuous,
+                         ws);
+    }
+    template <class BiIter>
+    bool
+    match_at(BiIter first, BiIter last, std::ptrdiff_t pos, std::span<std::ptrdiff_t> caps,
+             std::regex_constants::match_flag_type flags =
+               std::regex_constants::match_default) const {
+      return search_from(first, last, pos, caps, flags | std::regex_constants::match_continuous);
+    }
+  }; // class basic_nfa_regex
+
+  using nfa_regex = basic_nfa_regex<char>;
+  using wnfa_regex = basic_nfa_regex<wchar_t>;
+  using u8nfa_regex = basic_nfa_regex<char8_t>;
+  using u16nfa_regex = basic_nfa_regex<char16_t>;
+  using u32nfa_regex = basic_nfa_regex<char32_t>;
+} // namespace strtpl
@@ -0,0 +1,874 @@
+/// @file parsed_template.hpp
+#pragma once
+#include <algorithm> // std::copy, std::ranges::lower_bound, std::ranges::upper_bound
+#include <array>
+#include <cstddef>   // std::byte, std::size_t
+#include <cstdint>   // std::uint16_t, std::uint32_t, std::uint64_t, std::uintptr_t
+#include <cstring>   // std::memcpy
+#include <iterator>  // std::back_inserter
+#include <limits>    // std::numeric_limits
+#include <optional>
+#include <ranges>    // std::ranges::input_range
+#include <span>
+#include <stdexcept> // std::invalid_argument, std::length_error, std::out_of_range
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <strtpl/escape.hpp>
+#include <strtpl/regex_engine.hpp>
+#include <strtpl/string_template.hpp>
+
+namespace strtpl::inline STRTPL_INSTRUMENTATION_NAMESPACE {
+
+  // 解析済みの template
+  // 元の文字列 (source) をそのまま文字列の pool とし、それを区切った segment の列で表す。
+  // segment は source の一部をそのまま出力する literal か、key の表を指す placeholder である。
+  // 各行の先頭の位置も記録し、見つからない key を行番号と列番号で報告する。
+  // placeholder ごとに値のエスケープ (escape) を指定でき、描画時にコピーしながら施す。
+  // 値は書式として解釈せずにそのままコピーする。substitute は値を match_results::format に通すため、
+  // "$1" や "$&" を含む値では結果が異なる。
+  // section は続く segment の列 (中身) を行の数だけ繰り返す。入れ子にはできない。
+  //
+  // 直列化した形式 (全て実行環境のバイト順で、各配列は 4 byte 境界に揃う)
+  //   template_header
+  //   template_segment[nsegments]
+  //   template_key[nkeys]
+  //   std::uint32_t[nlines]  各行の先頭の位置 (空でなければ最初は 0)
+  //   CharT[source_length]
+  // mmap した領域などをそのまま basic_template_view として参照でき、読み込み時に解析も複製も行わない。
+
+  struct template_header {
+    static constexpr std::uint32_t magic_value = 0x4c505453; // "STPL"
+    static constexpr std::uint16_t version_value = 3;
+
+    std::uint32_t magic = magic_value;
+    std::uint16_t version = version_value;
+    std::uint16_t char_size = 0;
+    std::uint32_t nsegments = 0;
+    std::uint32_t nkeys = 0;
+    std::uint32_t nlines = 0;
+    std::uint32_t source_length = 0;
+    // literal の長さの合計 (出力の大きさを事前に計算するため)
+    std::uint32_t literal_length = 0;
+    std::uint32_t nsections = 0;
+  };
+  static_assert(sizeof(template_header) == 32);
+
+  struct template_segment {
+    static constexpr std::uint32_t literal = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::uint32_t section = literal - 1;
+
+    // key の表の添字 (literal または section ならばその値)
+    std::uint32_t key = literal;
+    // literal ならば出力する部分、placeholder ならば placeholder 全体、section ならば section の
+    // 名前の source での位置
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;
+    // placeholder のエスケープ。0 ならば描画時に指定したもの、それ以外は escape の値 + 1。
+    // section ならば中身の segment の数
+    std::uint32_t filter = 0;
+
+    constexpr escape
+    filter_or(escape policy) const noexcept {
+      return filter == 0 ? policy : static_cast<escape>(filter - 1);
+    }
+  };
+  static_assert(sizeof(template_segment) == 16);
+
+  struct template_key {
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;
+  };
+  static_assert(sizeof(template_key) == 8);
+
+  // section_map_with_key_type
+  // section の名前から行の範囲を引く map。各行は key から値を引く map である
+
+  template <class Sections, class Key>
+  concept section_map_with_key_type =
+    map_with_key_type<Sections, Key>
+    and std::ranges::input_range<std::remove_reference_t<map_mapped_t<Sections, Key>>>;
+
+  // basic_template_view
+  // 解析済みの template への参照。直列化した領域を指すものと basic_parsed_template が持つものがある
+
+  template <class CharT, class ST = std::char_traits<CharT>>
+  class basic_template_view {
+  public:
+    using string_view_type = std::basic_string_view<CharT, ST>;
+    using string_type = std::basic_string<CharT, ST>;
+
+  private:
+    string_view_type source_{};
+    std::span<const template_segment> segments_{};
+    std::span<const template_key> keys_{};
+    std::span<const std::uint32_t> lines_{};
+    std::size_t literal_length_ = 0;
+    std::size_t sections_ = 0;
+
+    [[noreturn]] void
+    not_found(const char* what, std::size_t offset) const {
+      const auto [line, col] = location(offset);
+      throw std::out_of_range(std::string("Error: ") + what + " not found: line "
+                              + std::to_string(line + 1) + ", col " + std::to_string(col + 1));
+    }
+
+    [[noreturn]] void
+    missing_at(std::size_t offset) const {
+      STRTPL_INSTRUMENT_ADD(missing_keys, 1);
+      not_found("key", offset);
+    }
+
+    [[noreturn]] void
+    missing(std::size_t k) const {
+      for (const auto& seg : segments_)
+        if (seg.key == k)
+          missing_at(seg.offset);
+      missing_at(keys_[k].offset);
+    }
+
+    template <class Map>
+    static bool
+    lookup(const Map& map, string_view_type k, string_view_type& value) {
+      auto it = map.find(k);
+      using std::end;
+      if (it == end(map))
+        return false;
+      value = string_view_type(get<1>(*it));
+      return true;
+    }
+
+    template <class OutputIter>
+    OutputIter
+    emit(OutputIter out, std::span<const string_view_type> values, escape policy) const {
+      for (const auto& seg : segments_) {
+        if (seg.key == template_segment::literal) {
+          const auto first = source_.begin() + seg.offset;
+          out = std::copy(first, first + seg.length, out);
+        } else {
+          out = escape_to(seg.filter_or(policy), values[seg.key], out);
+        }
+      }
+      return out;
+    }
+
+    // key が少なければ値をスタック上に置く
+    template <class Map, class Fn>
+    decltype(auto)
+    with_values(const Map& map, escape policy, Fn fn) const {
+      if (not escape_supported<CharT>(policy))
+        throw std::invalid_argument("Error: escape not supported for this character type");
+      constexpr std::size_t inline_keys = 16;
+      if (keys_.size() <= inline_keys) {
+        std::array<string_view_type, inline_keys> buf;
+        const auto values = std::span(buf).first(keys_.size());
+        const auto n = resolve(map, values, policy);
+        return fn(std::span<const string_view_type>(values), n);
+      }
+      std::vector<string_view_type> buf(keys_.size());
+      const auto n = resolve(map, buf, policy);
+      return fn(std::span<const string_view_type>(buf), n);
+    }
+
+    // section を含む template では、一巡目で全ての値を出現する順に (section の中身は行ごとに)
+    // 引いて values に並べ、各 section の行の数を rows に記録しながら出力の長さを求める。
+    // 二巡目 (emit_sections) は values と rows を先頭から読みながら書き込む
+    template <class Map, class Sections>
+    std::size_t
+    resolve_sections(const Map& map, const Sections& sections, escape policy,
+                     std::vector<string_view_type>& values, std::vector<std::size_t>& rows) const {
+      std::size_t n = 0;
+      const auto value = [&](const template_segment& seg, string_view_type v) {
+        values.push_back(v);
+        n += escaped_size(seg.filter_or(policy), v);
+      };
+      for (std::size_t i = 0; i < segments_.size(); ++i) {
+        const auto& seg = segments_[i];
+        if (seg.key == template_segment::literal) {
+          n += seg.length;
+          continue;
+        }
+        string_view_type v;
+        if (seg.key != template_segment::section) {
+          if (not lookup(map, key(seg.key), v))
+            missing_at(seg.offset);
+          value(seg, v);
+          continue;
+        }
+        auto it = sections.find(source_.substr(seg.offset, seg.length));
+        using std::end;
+        if (it == end(sections))
+          not_found("section", seg.offset);
+        const auto& range = get<1>(*it);
+        const auto body = segments_.subspan(i + 1, seg.filter);
+        if constexpr (std::ranges::sized_range<decltype(range)>) {
+          const auto placeholders = std::ranges::count_if(
+            body, [](const auto& b) { return b.key != template_segment::literal; });
+          values.reserve(values.size()
+                         + std::ranges::size(range) * static_cast<std::size_t>(placeholders));
+        }
+        std::size_t count = 0;
+        for (const auto& row : range) {
+          ++count;
+          for (const auto& b : body) {
+            if (b.key == template_segment::literal) {
+              n += b.length;
+              continue;
+            }
+            // 行に無い key は外側の map から引く
+            if (not lookup(row, key(b.key), v) and not lookup(map, key(b.key), v))
+              missing_at(b.offset);
+            value(b, v);
+          }
+        }
+        rows.push_back(count);
+        i += seg.filter;
+      }
+      return n;
+    }
+
+    template <class OutputIter>
+    OutputIter
+    emit_sections(OutputIter out, const string_view_type* value, const std::size_t* rows,
+                  escape policy) const {
+      const auto put = [&](const template_segment& seg) {
+        if (seg.key == template_segment::literal) {
+          const auto first = source_.begin() + seg.offset;
+          out = std::copy(first, first + seg.length, out);
+        } else {
+          out = escape_to(seg.filter_or(policy), *value++, out);
+        }
+      };
+      for (std::size_t i = 0; i < segments_.size(); ++i) {
+        const auto& seg = segments_[i];
+        if (seg.key != template_segment::section) {
+          put(seg);
+          continue;
+        }
+        const auto body = segments_.subspan(i + 1, seg.filter);
+        for (std::size_t count = *rows++; count != 0; --count)
+          for (const auto& b : body)
+            put(b);
+        i += seg.filter;
+      }
+      return out;
+    }
+
+    template <class Map, class Sections, class Fn>
+    decltype(auto)
+    with_sections(const Map& map, const Sections& sections, escape policy, Fn fn) const {
+      if (not escape_supported<CharT>(policy))
+        throw std::invalid_argument("Error: escape not supported for this character type");
+      std::vector<string_view_type> values;
+      values.reserve(segments_.size());
+      std::vector<std::size_t> rows;
+      rows.reserve(sections_);
+      const auto n = resolve_sections(map, sections, policy, values, rows);
+      return fn(values.data(), rows.data(), n);
+    }
+
+  public:
+    basic_template_view() = default;
+    basic_template_view(string_view_type source, std::span<const template_segment> segments,
+                        std::span<const template_key> keys, std::span<const std::uint32_t> lines,
+                        std::size_t literal_length, std::size_t sections = 0) noexcept
+      : source_(source), segments_(segments), keys_(keys), lines_(lines),
+        literal_length_(literal_length), sections_(sections) {}
+
+    // 直列化した領域を参照する。領域は 4 byte 境界に揃っていなければならない。
+    // header と全体の大きさに加えて、segment, key, 行の位置が source の中を指し、key の添字、
+    // エスケープ、section の中身の数と数が正しいことを O(segment + key + 行) で検査する
+    static basic_template_view
+    from_bytes(std::span<const std::byte> bytes) {
+      if (bytes.size() < sizeof(template_header)
+          or reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(template_header) != 0)
+        throw std::runtime_error("Error: invalid template image");
+      template_header h;
+      std::memcpy(&h, bytes.data(), sizeof(h));
+      if (h.magic != template_header::magic_value or h.version != template_header::version_value
+          or h.char_size != sizeof(CharT))
+        throw std::runtime_error("Error: invalid template image");
+      const std::size_t size = sizeof(template_header) + h.nsegments * sizeof(template_segment)
+                               + h.nkeys * sizeof(template_key) + h.nlines * sizeof(std::uint32_t)
+                               + std::size_t{h.source_length} * sizeof(CharT);
+      if (bytes.size() < size)
+        throw std::runtime_error("Error: truncated template image");
+      const std::byte* p = bytes.data() + sizeof(template_header);
+      const auto take = [&p]<class T>(std::size_t n) {
+        const auto r = std::span(reinterpret_cast<const T*>(p), n);
+        p += n * sizeof(T);
+        return r;
+      };
+      const auto segments = take.template operator()<template_segment>(h.nsegments);
+      const auto keys = take.template operator()<template_key>(h.nkeys);
+      const auto lines = take.template operator()<std::uint32_t>(h.nlines);
+      const auto source = take.template operator()<CharT>(h.source_length);
+      const auto invalid = [] { throw std::runtime_error("Error: invalid template image"); };
+      const auto in_source = [&h](std::uint64_t offset, std::uint64_t length) {
+        return offset + length <= h.source_length;
+      };
+      std::uint64_t literal_length = 0;
+      std::size_t sections = 0;
+      for (std::size_t i = 0; i < segments.size(); ++i) {
+        const auto& seg = segments[i];
+        if (not in_source(seg.offset, seg.length))
+          invalid();
+        if (seg.key == template_segment::literal) {
+          literal_length += seg.length;
+        } else if (seg.key == template_segment::section) {
+          // section の中身は続く segment で、section を含まない
+          if (seg.filter > segments.size() - i - 1)
+            invalid();
+          for (const auto& b : segments.subspan(i + 1, seg.filter))
+            if (b.key == template_segment::section)
+              invalid();
+          ++sections;
+        } else if (seg.key >= keys.size()
+                   or (seg.filter != 0
+                       and (seg.filter > static_cast<std::uint32_t>(escape::shell) + 1
+                            or not escape_supported<CharT>(seg.filter_or(escape::none))))) {
+          invalid();
+        }
+      }
+      if (literal_length != h.literal_length or sections != h.nsections)
+        invalid();
+      for (const auto& k : keys)
+        if (not in_source(k.offset, k.length))
+          invalid();
+      for (std::size_t i = 0; i < lines.size(); ++i)
+        if (lines[i] > h.source_length or (i == 0 ? lines[i] != 0 : lines[i] <= lines[i - 1]))
+          invalid();
+      return {string_view_type(source.data(), source.size()), segments, keys, lines,
+              h.literal_length, h.nsections};
+    }
+
+    std::size_t
+    serialized_size() const noexcept {
+      return sizeof(template_header) + segments_.size_bytes() + keys_.size_bytes()
+             + lines_.size_bytes() + source_.size() * sizeof(CharT);
+    }
+
+    // out には serialized_size() byte 書き込める 4 byte 境界に揃った領域を渡す
+    std::byte*
+    serialize(std::byte* out) const {
+      template_header h;
+      h.char_size = sizeof(CharT);
+      h.nsegments = static_cast<std::uint32_t>(segments_.size());
+      h.nkeys = static_cast<std::uint32_t>(keys_.size());
+      h.nlines = static_cast<std::uint32_t>(lines_.size());
+      h.source_length = static_cast<std::uint32_t>(source_.size());
+      h.literal_length = static_cast<std::uint32_t>(literal_length_);
+      h.nsections = static_cast<std::uint32_t>(sections_);
+      const auto put = [&out](const void* p, std::size_t n) {
+        if (n != 0)
+          std::memcpy(out, p, n);
+        out += n;
+      };
+      put(&h, sizeof(h));
+      put(segments_.data(), segments_.size_bytes());
+      put(keys_.data(), keys_.size_bytes());
+      put(lines_.data(), lines_.size_bytes());
+      put(source_.data(), source_.size() * sizeof(CharT));
+      return out;
+    }
+
+    std::vector<std::byte>
+    serialize() const {
+      std::vector<std::byte> r(serialized_size());
+      serialize(r.data());
+      return r;
+    }
+
+    // 全ての key を引いて values (key_count() 個) に書き込み、エスケープ後の出力の長さを返す。
+    // 見つからない key があれば、最初に現れる位置を添えて std::out_of_range を送出する。
+    // section を含む template では行を引けないため、最初の section の位置を添えて送出する
+    template <class Map>
+    std::size_t
+    resolve(const Map& map, std::span<string_view_type> values,
+            escape policy = escape::none) const {
+      if (sections_ != 0)
+        for (const auto& seg : segments_)
+          if (seg.key == template_segment::section)
+            not_found("section", seg.offset);
+      for (std::size_t i = 0; i < keys_.size(); ++i)
+        if (not lookup(map, key(i), values[i]))
+          missing(i);
+      std::size_t n = literal_length_;
+      for (const auto& seg : segments_)
+        if (seg.key != template_segment::literal)
+          n += escaped_size(seg.filter_or(policy), values[seg.key]);
+      return n;
+    }
+
+    string_view_type
+    source() const noexcept {
+      return source_;
+    }
+    std::span<const template_segment>
+    segments() const noexcept {
+      return segments_;
+    }
+    std::size_t
+    key_count() const noexcept {
+      return keys_.size();
+    }
+    string_view_type
+    key(std::size_t i) const noexcept {
+      return source_.substr(keys_[i].offset, keys_[i].length);
+    }
+    std::size_t
+    literal_length() const noexcept {
+      return literal_length_;
+    }
+    std::size_t
+    section_count() const noexcept {
+      return sections_;
+    }
+
+    // source での位置から (行, 列) を求める (共に 0 始まり)
+    std::pair<std::size_t, std::size_t>
+    location(std::size_t offset) const noexcept {
+      const auto i = std::ranges::upper_bound(lines_, offset) - lines_.begin();
+      const std::size_t line = i == 0 ? 0 : static_cast<std::size_t>(i - 1);
+      return {line, lines_.empty() ? offset : offset - lines_[line]};
+    }
+
+    // 全ての key を先に引き、出力の大きさを確定してから書き込む。
+    // policy はエスケープを指定していない placeholder に施す
+    template <class OutputIter, class Map>
+    requires map_with_key_type<const Map, string_view_type>
+    OutputIter
+    render(OutputIter out, const Map& map, escape policy = escape::none) const {
+      STRTPL_INSTRUMENT_ADD(renders, 1);
+      return with_values(map, policy, [&](std::span<const string_view_type> values, std::size_t) {
+        return emit(out, values, policy);
+      });
+    }
+
+    template <class Map>
+    requires map_with_key_type<const Map, string_view_type>
+    string_type
+    operator()(const Map& map, escape policy = escape::none) const {
+      STRTPL_INSTRUMENT_ADD(renders, 1);
+      return with_values(map, policy, [&](std::span<const string_view_type> values, std::size_t n) {
+        string_type r(n, CharT());
+        emit(r.data(), values, policy);
+        STRTPL_INSTRUMENT_ADD(output_bytes, r.size() * sizeof(CharT));
+        return r;
+      });
+    }
+
+    // section を含む template の描画。sections は section の名前から行 (map) の範囲を引く。
+    // section の中の key は行から引き、見つからなければ map から引く。
+    // 全ての行の値を先に引き、出力の大きさを確定してから一度に書き込む
+    template <class OutputIter, class Map, class Sections>
+    requires map_with_key_type<const Map, string_view_type>
+             and section_map_with_key_type<const Sections, string_view_type>
+    OutputIter
+    render(OutputIter out, const Map& map, const Sections& sections,
+           escape policy = escape::none) const {
+      STRTPL_INSTRUMENT_ADD(renders, 1);
+      return with_sections(map, sections, policy,
+                           [&](const string_view_type* values, const std::size_t* rows,
+                               std::size_t) { return emit_sections(out, values, rows, policy); });
+    }
+
+    template <class Map, class Sections>
+    requires map_with_key_type<const Map, string_view_type>
+             and section_map_with_key_type<const Sections, string_view_type>
+    string_type
+    operator()(const Map& map, const Sections& sections, escape policy = escape::none) const {
+      STRTPL_INSTRUMENT_ADD(renders, 1);
+      return with_sections(
+        map, sections, policy,
+        [&](const string_view_type* values, const std::size_t* rows, std::size_t n) {
+          string_type r(n, CharT());
+          emit_sections(r.data(), values, rows, policy);
+          STRTPL_INSTRUMENT_ADD(output_bytes, r.size() * sizeof(CharT));
+          return r;
+        });
+    }
+  }; // class basic_template_view
+
+  // basic_parsed_template
+  // basic_template_view が参照する領域を所有する
+
+  template <class CharT, class ST = std::char_traits<CharT>>
+  class basic_parsed_template {
+  public:
+    using view_type = basic_template_view<CharT, ST>;
+    using string_view_type = std::basic_string_view<CharT, ST>;
+    using string_type = std::basic_string<CharT, ST>;
+
+  private:
+    string_type source_{};
+    std::vector<template_segment> segments_{};
+    std::vector<template_key> keys_{};
+    std::vector<std::uint32_t> lines_{};
+    std::size_t literal_length_ = 0;
+    std::size_t sections_ = 0;
+
+  public:
+    basic_parsed_template() = default;
+    basic_parsed_template(string_type source, std::vector<template_segment> segments,
+                          std::vector<template_key> keys, std::vector<std::uint32_t> lines)
+      : source_(std::move(source)), segments_(std::move(segments)), keys_(std::move(keys)),
+        lines_(std::move(lines)) {
+      for (const auto& seg : segments_) {
+        if (seg.key == template_segment::literal)
+          literal_length_ += seg.length;
+        else if (seg.key == template_segment::section)
+          ++sections_;
+      }
+    }
+
+    view_type
+    view() const noexcept {
+      return {source_, segments_, keys_, lines_, literal_length_, sections_};
+    }
+    operator view_type() const noexcept {
+      return view();
+    }
+
+    template <class Map>
+    requires map_with_key_type<const Map, string_view_type>
+    string_type
+    operator()(const Map& map, escape policy = escape::none) const {
+      return view()(map, policy);
+    }
+    template <class OutputIter, class Map>
+    requires map_with_key_type<const Map, string_view_type>
+    OutputIter
+    render(OutputIter out, const Map& map, escape policy = escape::none) const {
+      return view().render(out, map, policy);
+    }
+    template <class Map, class Sections>
+    requires map_with_key_type<const Map, string_view_type>
+             and section_map_with_key_type<const Sections, string_view_type>
+    string_type
+    operator()(const Map& map, const Sections& sections, escape policy = escape::none) const {
+      return view()(map, sections, policy);
+    }
+    template <class OutputIter, class Map, class Sections>
+    requires map_with_key_type<const Map, string_view_type>
+             and section_map_with_key_type<const Sections, string_view_type>
+    OutputIter
+    render(OutputIter out, const Map& map, const Sections& sections,
+           escape policy = escape::none) const {
+      return view().render(out, map, sections, policy);
+    }
+    std::vector<std::byte>
+    serialize() const {
+      return view().serialize();
+    }
+  }; // class basic_parsed_template
+
+  using parsed_template = basic_parsed_template<char>;
+  using wparsed_template = basic_parsed_template<wchar_t>;
+  using template_view = basic_template_view<char>;
+  using wtemplate_view = basic_template_view<wchar_t>;
+
+  // parse
+  // tpl と同じ規則で s を解析する。不正な placeholder があれば tpl と同じ例外を送出する。
+  // braceidpattern に一致した部分が "key|name" の形ならば name をエスケープの名前とする
+  // (filtered_substitute を参照)。未知の名前は不正な placeholder として扱う。
+  // "#name" と "/name" は section の始まりと終わりとする (section_substitute を参照)。
+  // 入れ子の section、対応しない終わり、閉じていない section は不正な placeholder として扱う
+
+  template <class CharT, class ST, class Regex>
+  basic_parsed_template<CharT, ST>
+  parse(const basic_string_template<CharT, ST, Regex>& tpl, std::basic_string_view<CharT, ST> s) {
+    if (s.size() >= std::numeric_limits<std::uint32_t>::max())
+      throw std::length_error("Error: template too long");
+    using BiIter = typename std::basic_string_view<CharT, ST>::iterator;
+    using Iter = regex_iterator_for_t<BiIter, Regex>;
+    const auto u32 = [](auto n) { return static_cast<std::uint32_t>(n); };
+
+    std::vector<template_segment> segments;
+    std::vector<template_key> keys;
+    const auto literal = [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+      if (first == last)
+        return;
+      // 連続する literal はまとめる
+      if (not segments.empty() and segments.back().key == template_segment::literal
+          and segments.back().offset + segments.back().length == u32(first))
+        segments.back().length += u32(last - first);
+      else
+        segments.push_back({template_segment::literal, u32(first), u32(last - first)});
+    };
+    const auto key_index = [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+      const auto k =
+        s.substr(static_cast<std::size_t>(first), static_cast<std::size_t>(last - first));
+      for (std::size_t i = 0; i < keys.size(); ++i)
+        if (s.substr(keys[i].offset, keys[i].length) == k)
+          return u32(i);
+      keys.push_back({u32(first), u32(last - first)});
+      return u32(keys.size() - 1);
+    };
+
+    const auto re = tpl.regex();
+    const auto pos = [&s](BiIter i) { return i - s.begin(); };
+    std::ptrdiff_t last = 0;
+    // 開いている section の segment の添字 (無ければ closed) と、その placeholder の位置
+    constexpr std::size_t closed = std::numeric_limits<std::size_t>::max();
+    std::size_t open = closed;
+    BiIter open_at{};
+    for (Iter i(s.begin(), s.end(), re, tpl.match_flags()), end; i != end; ++i) {
+      const auto& mo = *i;
+      const auto first = pos(mo[0].first);
+      literal(last, first);
+      last = pos(mo[0].second);
+      if (mo[1].matched)
+        segments.push_back({key_index(pos(mo[1].first), pos(mo[1].second)), u32(first),
+                            u32(last - first)});
+      else if (mo[2].matched) {
+        const auto id = s.substr(static_cast<std::size_t>(pos(mo[2].first)),
+                                 static_cast<std::size_t>(mo[2].length()));
+        if (id.front() == CharT('#') or id.front() == CharT('/')) {
+          const auto name = id.substr(1);
+          if (name.find(CharT('|')) != name.npos)
+            _invalid(s.begin(), mo[0].first);
+          if (id.front() == CharT('#')) {
+            if (open != closed)
+              _invalid(s.begin(), mo[0].first);
+            open = segments.size();
+            open_at = mo[0].first;
+            segments.push_back(
+              {template_segment::section, u32(pos(mo[2].first) + 1), u32(name.size())});
+          } else {
+            if (open == closed or s.substr(segments[open].offset, segments[open].length) != name)
+              _invalid(s.begin(), mo[0].first);
+            segments[open].filter = u32(segments.size() - open - 1);
+            open = closed;
+          }
+          continue;
+        }
+        const auto bar = id.rfind(CharT('|'));
+        std::uint32_t filter = 0;
+        if (bar != id.npos) {
+          std::string name;
+          for (const CharT c : id.substr(bar + 1))
+            name.push_back(static_cast<unsigned>(c) < 0x80 ? static_cast<char>(c) : '\0');
+          const auto e = escape_from_name(name);
+          if (not e or not escape_supported<CharT>(*e))
+            _invalid(s.begin(), mo[0].first);
+          filter = static_cast<std::uint32_t>(*e) + 1;
+        }
+        const auto key_first = pos(mo[2].first);
+        const auto key_last = bar == id.npos ? pos(mo[2].second)
+                                             : key_first + static_cast<std::ptrdiff_t>(bar);
+        segments.push_back(
+          {key_index(key_first, key_last), u32(first), u32(last - first), filter});
+      }
+      else if (mo[3].matched)
+        literal(pos(mo[3].first), pos(mo[3].second));
+      else
+        _invalid(s.begin(), mo[0].first);
+    }
+    literal(last, std::ssize(s));
+    if (open != closed)
+      _invalid(s.begin(), open_at);
+
+    // 改行は _invalid と同じく \r\n, \r, \n, \v, \f
+    std::vector<std::uint32_t> lines{0};
+    for (std::size_t i = 0; i < s.size(); ++i) {
+      const CharT c = s[i];
+      if (c == CharT('\r') and i + 1 < s.size() and s[i + 1] == CharT('\n'))
+        ++i;
+      else if (c != CharT('\r') and c != CharT('\n') and c != CharT('\v') and c != CharT('\f'))
+        continue;
+      lines.push_back(u32(i + 1));
+    }
+    return {std::basic_string<CharT, ST>(s), std::move(segments), std::move(keys),
+            std::move(lines)};
+  }
+
+  // basic_template_grammar
+  // parse だけが解釈する構文 (${key|name} や ${#name}...${/name}) を加えた template の規則。
+  // basic_string_template として直接呼び出すと構文が key の一部として扱われるため、
+  // 呼び出せない型に包み、parse にだけ渡せるようにする
+
+  template <class CharT, class ST = std::char_traits<CharT>, class Regex = default_regex_t<CharT>>
+  struct basic_template_grammar {
+    basic_string_template<CharT, ST, Regex> rules{};
+  };
+
+  using template_grammar = basic_template_grammar<char>;
+  using wtemplate_grammar = basic_template_grammar<wchar_t>;
+  using u8template_grammar = basic_template_grammar<char8_t>;
+
+  template <class CharT, class ST, class Regex>
+  basic_parsed_template<CharT, ST>
+  parse(const basic_template_grammar<CharT, ST, Regex>& grammar,
+        std::basic_string_view<CharT, ST> s) {
+    return parse(grammar.rules, s);
+  }
+
+  inline namespace cpo {
+    // ${key|name} でエスケープを指定できる substitute。parse で解析して使う。
+    // name は none (raw), html, json, url, shell
+    inline constexpr template_grammar filtered_substitute{
+      {"$", "([_a-zA-Z][_a-zA-Z0-9]*)", R"(([_a-zA-Z][_a-zA-Z0-9]*(?:\|[a-z]+)?))"}};
+    inline constexpr wtemplate_grammar wfiltered_substitute{
+      {L"$", L"([_a-zA-Z][_a-zA-Z0-9]*)", LR"(([_a-zA-Z][_a-zA-Z0-9]*(?:\|[a-z]+)?))"}};
+    inline constexpr u8template_grammar u8filtered_substitute{
+      {u8"$", u8R"((\p{ID_Start}\p{ID_Continue}*))",
+       u8R"((\p{ID_Start}\p{ID_Continue}*(?:\|[a-z]+)?))"}};
+
+    // ${#name}...${/name} で囲んだ部分を行ごとに繰り返す substitute。${key|name} も使える。
+    // parse で解析し、section の名前から行の範囲を引く map と共に描画する
+    inline constexpr template_grammar section_substitute{
+      {"$", "([_a-zA-Z][_a-zA-Z0-9]*)", R"(([#/]?[_a-zA-Z][_a-zA-Z0-9]*(?:\|[a-z]+)?))"}};
+    inline constexpr wtemplate_grammar wsection_substitute{
+      {L"$", L"([_a-zA-Z][_a-zA-Z0-9]*)", LR"(([#/]?[_a-zA-Z][_a-zA-Z0-9]*(?:\|[a-z]+)?))"}};
+    inline constexpr u8template_grammar u8section_substitute{
+      {u8"$", u8R"((\p{ID_Start}\p{ID_Continue}*))",
+       u8R"(([#/]?\p{ID_Start}\p{ID_Continue}*(?:\|[a-z]+)?))"}};
+  } // namespace cpo
+
+  // 直列化した template の束
+  //   bundle_header
+  //   bundle_entry[count]  名前の順に整列している
+  //   char[names_length]   名前を連結したもの
+  //   template (8 byte 境界に揃える)...
+
+  struct bundle_header {
+    static constexpr std::uint32_t magic_value = 0x42505453; // "STPB"
+    static constexpr std::uint16_t version_value = 1;
+
+    std::uint32_t magic = magic_value;
+    std::uint16_t version = version_value;
+    std::uint16_t char_size = 0;
+    std::uint32_t count = 0;
+    std::uint32_t names_length = 0;
+  };
+  static_assert(sizeof(bundle_header) == 16);
+
+  struct bundle_entry {
+    std::uint32_t name_offset = 0;
+    std::uint32_t name_length = 0;
+    // 束の先頭からの位置と大きさ
+    std::uint64_t offset = 0;
+    std::uint64_t size = 0;
+  };
+  static_assert(sizeof(bundle_entry) == 24);
+
+  // basic_template_bundle_view
+
+  template <class CharT, class ST = std::char_traits<CharT>>
+  class basic_template_bundle_view {
+  public:
+    using view_type = basic_template_view<CharT, ST>;
+
+  private:
+    std::span<const std::byte> bytes_{};
+    std::span<const bundle_entry> entries_{};
+    std::string_view names_{};
+
+  public:
+    basic_template_bundle_view() = default;
+
+    // header と目録を検査する (名前が名前の領域の中にあり、整列していること)。
+    // 各 template は引いたときに検査する
+    explicit basic_template_bundle_view(std::span<const std::byte> bytes) : bytes_(bytes) {
+      if (bytes.size() < sizeof(bundle_header)
+          or reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(bundle_entry) != 0)
+        throw std::runtime_error("Error: invalid template bundle");
+      bundle_header h;
+      std::memcpy(&h, bytes.data(), sizeof(h));
+      if (h.magic != bundle_header::magic_value or h.version != bundle_header::version_value
+          or h.char_size != sizeof(CharT))
+        throw std::runtime_error("Error: invalid template bundle");
+      const std::size_t dir = sizeof(bundle_header) + h.count * sizeof(bundle_entry);
+      if (bytes.size() < dir + h.names_length)
+        throw std::runtime_error("Error: truncated template bundle");
+      entries_ = std::span(
+        reinterpret_cast<const bundle_entry*>(bytes.data() + sizeof(bundle_header)), h.count);
+      names_ = std::string_view(reinterpret_cast<const char*>(bytes.data() + dir), h.names_length);
+      for (std::size_t i = 0; i < entries_.size(); ++i) {
+        const auto& e = entries_[i];
+        if (std::uint64_t{e.name_offset} + e.name_length > names_.size()
+            or (i != 0 and name(i - 1) > name(i)))
+          throw std::runtime_error("Error: invalid template bundle");
+      }
+    }
+
+    std::size_t
+    size() const noexcept {
+      return entries_.size();
+    }
+    std::string_view
+    name(std::size_t i) const noexcept {
+      return names_.substr(entries_[i].name_offset, entries_[i].name_length);
+    }
+    view_type
+    operator[](std::size_t i) const {
+      const auto& e = entries_[i];
+      if (e.offset > bytes_.size() or e.size > bytes_.size() - e.offset)
+        throw std::runtime_error("Error: truncated template bundle");
+      return view_type::from_bytes(bytes_.subspan(e.offset, e.size));
+    }
+
+    std::optional<view_type>
+    find(std::string_view name) const {
+      const auto i = std::ranges::lower_bound(
+        entries_, name, {},
+        [this](const bundle_entry& e) { return names_.substr(e.name_offset, e.name_length); });
+      if (i == entries_.end() or names_.substr(i->name_offset, i->name_length) != name)
+        return std::nullopt;
+      return (*this)[static_cast<std::size_t>(i - entries_.begin())];
+    }
+  }; // class basic_template_bundle_view
+
+  using template_bundle_view = basic_template_bundle_view<char>;
+  using wtemplate_bundle_view = basic_template_bundle_view<wchar_t>;
+
+  // make_template_bundle
+  // (名前, basic_template_view に変換できるもの) の組の範囲を束に直列化する
+
+  // clang-format off
+  template <std::ranges::input_range Range>
+  requires requires(std::ranges::range_reference_t<Range> x) {
+    std::string_view(get<0>(x));
+    get<1>(x).view();
+  }
+  std::vector<std::byte>
+  // clang-format on
+  make_template_bundle(Range&& r) {
+    using view_type = std::remove_cvref_t<decltype(get<1>(*std::ranges::begin(r)).view())>;
+    using char_type = typename view_type::string_view_type::value_type;
+    std::vector<std::pair<std::string_view, view_type>> items;
+    for (auto&& x : r)
+      items.emplace_back(std::string_view(get<0>(x)), get<1>(x).view());
+    std::ranges::sort(items, {}, [](const auto& x) { return x.first; });
+
+    const auto align = [](std::size_t n) { return (n + 7) / 8 * 8; };
+    std::size_t names_length = 0;
+    for (const auto& [name, v] : items)
+      names_length += name.size();
+    std::size_t size =
+      align(sizeof(bundle_header) + items.size() * sizeof(bundle_entry) + names_length);
+    std::vector<bundle_entry> entries;
+    std::size_t name_offset = 0;
+    for (const auto& [name, v] : items) {
+      entries.push_back({static_cast<std::uint32_t>(name_offset),
+                         static_cast<std::uint32_t>(name.size()), size, v.serialized_size()});
+      name_offset += name.size();
+      size = align(size + v.serialized_size());
+    }
+
+    std::vector<std::byte> bytes(size);
+    bundle_header h;
+    h.char_size = sizeof(char_type);
+    h.count = static_cast<std::uint32_t>(items.size());
+    h.names_length = static_cast<std::uint32_t>(names_length);
+    auto p = std::ranges::copy(std::as_bytes(std::span(&h, 1)), bytes.begin()).out;
+    p = std::ranges::copy(std::as_bytes(std::span(entries)), p).out;
+    for (const auto& [name, v] : items)
+      p = std::ranges::copy(std::as_bytes(std::span(name)), p).out;
+    for (std::size_t i = 0; i < items.size(); ++i)
+      items[i].second.serialize(bytes.data() + entries[i].offset);
+    return bytes;
+  }
+} // namespace strtpl::inline STRTPL_INSTRUMENTATION_NAMESPACE
@@ -1,15 +1,21 @@
 /// @file regex.hpp
+#pragma once
 #include <algorithm>  // std::copy
+#include <array>
+#include <cstddef>    // std::ptrdiff_t, std::size_t
 #include <functional> // std::invoke
-#include <iterator>   // std::iterator_traits, std::back_inserter
-#include <ranges> // std::ranges::subrange, std::views::join, std::views::transform, std::views::take
+#include <iterator>   // std::iterator_traits, std::back_inserter, std::forward_iterator
+#include <ranges> // std::ranges::subrange, std::views::join, std::views::transform
 #include <regex>
 #include <string_view>
 #include <type_traits> // std::remove_cvref_t
 #include <utility>
+#include <strtpl/instrumentation.hpp>
+#include <strtpl/regex_engine.hpp>
+#include <strtpl/static_regex.hpp>
 #include <strtpl/trailing_view.hpp>
 
-namespace strtpl::regex {
+namespace strtpl::regex::inline STRTPL_INSTRUMENTATION_NAMESPACE {
 
   // match_results_format
 
@@ -44,6 +50,17 @@ namespace strtpl::regex {
     return {Iter(s.begin(), s.end(), re, flags), Iter()};
   }
 
+  // clang-format off
+  template <class CharT, class ST, class Re,
+            class Iter = engine_iterator<typename std::basic_string_view<CharT, ST>::iterator, Re>>
+  requires regex_engine<Re, typename std::basic_string_view<CharT, ST>::iterator>
+  std::ranges::subrange<Iter>
+  // clang-format on
+  regex_range(std::basic_string_view<CharT, ST> s, const Re& re,
+              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return {Iter(s.begin(), s.end(), re, flags), Iter()};
+  }
+
   // regex_replace_fn
 
   template <class T, class CharT>
@@ -60,26 +77,36 @@ namespace strtpl::regex {
                        is_std_basic_string_view_with_char_type<
                          std::invoke_result_t<Fn&, const std::match_results<BiIter>&>, CharT>>;
 
-  // clang-format off
-  template <class OutputIter, class Traits, class CharT, class ST, class Fn>
-  requires regex_replace_fn_constraint<CharT, ST, Fn>
+  template <class CharT, class ST, class Re, class Fn,
+            class BiIter = typename std::basic_string_view<CharT, ST>::iterator>
+  inline constexpr bool regex_engine_replace_fn_constraint =
+    std::conjunction_v<std::is_invocable<Fn&, const engine_match_t<BiIter, Re>&>,
+                       is_std_basic_string_view_with_char_type<
+                         std::invoke_result_t<Fn&, const engine_match_t<BiIter, Re>&>, CharT>>;
+
+  template <class OutputIter, class CharT, class ST, class Re, class Fn>
   OutputIter
-  // clang-format on
-  regex_replace_fn(
-    OutputIter out, std::basic_string_view<CharT, ST> s, const std::basic_regex<CharT, Traits>& re,
-    Fn fn, std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+  _regex_replace_fn(OutputIter out, std::basic_string_view<CharT, ST> s, const Re& re, Fn& fn,
+                    std::regex_constants::match_flag_type flags) {
+    STRTPL_INSTRUMENT_ADD(replacements, 1);
+    STRTPL_INSTRUMENT_ADD(input_bytes, s.size() * sizeof(CharT));
+    // 一致の探索は regex_range の構築時とイテレータを進めるときに行われる
+    STRTPL_INSTRUMENT_PHASE_BEGIN(match_ns);
     auto r = trailing_view(regex_range(s, re, flags), 2);
     const bool format_copy = !(flags & std::regex_constants::format_no_copy);
     if (r.empty()) {
+      STRTPL_INSTRUMENT_PHASE(copy_ns);
       if (format_copy)
         out = std::copy(s.begin(), s.end(), out);
     } else {
       const bool format_first_only = flags & std::regex_constants::format_first_only;
       for (const auto& [mr, last] : r) {
+        STRTPL_INSTRUMENT_PHASE(copy_ns);
         if (last) {
           out = std::copy(mr.suffix().first, mr.suffix().second, out);
           break;
         }
+        STRTPL_INSTRUMENT_ADD(matches, 1);
         if (format_copy)
           out = std::copy(mr.prefix().first, mr.prefix().second, out);
         out = match_results_format(mr, out, std::invoke(fn, mr), flags);
@@ -87,11 +114,35 @@ namespace strtpl::regex {
           out = std::copy(mr.suffix().first, mr.suffix().second, out);
           break;
         }
+        STRTPL_INSTRUMENT_PHASE(match_ns);
       }
     }
     return out;
   }
 
+  // clang-format off
+  template <class OutputIter, class Traits, class CharT, class ST, class Fn>
+  requires regex_replace_fn_constraint<CharT, ST, Fn>
+  OutputIter
+  // clang-format on
+  regex_replace_fn(
+    OutputIter out, std::basic_string_view<CharT, ST> s, const std::basic_regex<CharT, Traits>& re,
+    Fn fn, std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return _regex_replace_fn(out, s, re, fn, flags);
+  }
+
+  // clang-format off
+  template <class OutputIter, class CharT, class ST, class Re, class Fn>
+  requires regex_engine<Re, typename std::basic_string_view<CharT, ST>::iterator>
+    and regex_engine_replace_fn_constraint<CharT, ST, Re, Fn>
+  OutputIter
+  // clang-format on
+  regex_replace_fn(
+    OutputIter out, std::basic_string_view<CharT, ST> s, const Re& re, Fn fn,
+    std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return _regex_replace_fn(out, s, re, fn, flags);
+  }
+
   // clang-format off
   template <class Traits, class CharT, class ST, class Fn>
   requires regex_replace_fn_constraint<CharT, ST, Fn>
@@ -101,44 +152,232 @@ namespace strtpl::regex {
     std::basic_string_view<CharT, ST> s, const std::basic_regex<CharT, Traits>& re, Fn fn,
     std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
     std::basic_string<CharT, ST> r;
-    regex_replace_fn(std::back_inserter(r), s, re, fn, flags);
+    regex_replace_fn(instrumentation::string_inserter(r), s, re, fn, flags);
+    STRTPL_INSTRUMENT_ADD(output_bytes, r.size() * sizeof(CharT));
     return r;
   }
 
+  // clang-format off
+  template <class CharT, class ST, class Re, class Fn>
+  requires regex_engine<Re, typename std::basic_string_view<CharT, ST>::iterator>
+    and regex_engine_replace_fn_constraint<CharT, ST, Re, Fn>
+  std::basic_string<CharT, ST>
+  // clang-format on
+  regex_replace_fn(
+    std::basic_string_view<CharT, ST> s, const Re& re, Fn fn,
+    std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    std::basic_string<CharT, ST> r;
+    // strtpl::regex_replace_fn が ADL で見つからないよう修飾する
+    regex::regex_replace_fn(instrumentation::string_inserter(r), s, re, fn, flags);
+    STRTPL_INSTRUMENT_ADD(output_bytes, r.size() * sizeof(CharT));
+    return r;
+  }
+
+  // clang-format off
+  template <basic_fixed_string Pattern, class CharT, class ST, class Fn>
+  requires regex_engine_replace_fn_constraint<CharT, ST, static_regex<Pattern>, Fn>
+  std::basic_string<CharT, ST>
+  // clang-format on
+  regex_replace_fn(
+    std::basic_string_view<CharT, ST> s, Fn fn,
+    std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return regex::regex_replace_fn(s, static_regex_v<Pattern>, fn, flags);
+  }
+
+  // bounded_iterator
+  // 一致を高々 n 個だけ列挙する。n 個目から進めるときは元のイテレータを進めずに終端にするため、
+  // std::views::take と異なり、上限に達した後で残りの文字列を探索しない。
+  // Iter は値初期化したものが終端を表すこと (std::regex_iterator, engine_iterator)
+
+  template <std::forward_iterator Iter>
+  class bounded_iterator {
+  private:
+    Iter i_{};
+    std::size_t remaining_ = 0;
+
+  public:
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::iter_value_t<Iter>;
+    using difference_type = std::iter_difference_t<Iter>;
+
+    bounded_iterator() = default;
+    constexpr bounded_iterator(Iter i, std::size_t n)
+      : i_(n == 0 ? Iter() : std::move(i)), remaining_(n) {}
+
+    constexpr decltype(auto)
+    operator*() const {
+      return *i_;
+    }
+
+    constexpr bounded_iterator&
+    operator++() {
+      if (--remaining_ == 0)
+        i_ = Iter();
+      else
+        ++i_;
+      return *this;
+    }
+    constexpr bounded_iterator
+    operator++(int) {
+      auto tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    friend constexpr bool
+    operator==(const bounded_iterator& x, const bounded_iterator& y) {
+      return x.i_ == y.i_;
+    }
+  }; // class bounded_iterator
+
+  template <std::ranges::forward_range Range,
+            class Iter = bounded_iterator<std::ranges::iterator_t<Range>>>
+  std::ranges::subrange<Iter>
+  _bounded_range(Range&& rng, std::size_t n) {
+    return {Iter(std::ranges::begin(rng), n), Iter()};
+  }
+
   // regex_count
+  // 一致の数と、最後の一致より後ろの部分の長さ (一致が無ければ s の長さ) を組で返す。
+  // format_first_only ならば最初の一致で止める
+
+  template <class Range, class CharT, class ST>
+  std::pair<std::ptrdiff_t, std::ptrdiff_t>
+  _regex_count(Range&& rng, std::basic_string_view<CharT, ST> s) {
+    std::ptrdiff_t n = 0, m = std::ranges::ssize(s);
+    for (const auto& mr : rng) {
+      ++n;
+      m = mr.suffix().length();
+    }
+    return {n, m};
+  }
+
+  inline std::size_t
+  _regex_count_limit(std::regex_constants::match_flag_type flags) noexcept {
+    return flags & std::regex_constants::format_first_only ? 1 : static_cast<std::size_t>(-1);
+  }
 
-  /* template <class Traits, class CharT, class ST>
+  template <class Traits, class CharT, class ST>
   std::pair<std::ptrdiff_t, std::ptrdiff_t>
   regex_count(std::basic_string_view<CharT, ST> s, const std::basic_regex<CharT, Traits>& re,
               std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
-    auto r = trailing_view(regex_range(s, re, flags), 2);
-    std::ptrdiff_t n = 0, m = 0;
-    if (r.empty()) {
-      m = s.length();
-    } else {
-      const bool format_first_only = flags & std::regex_constants::format_first_only;
-      for (const auto& [mr, last] : r) {
-        if (last) {
-          m = mr.suffix().length();
-          break;
-        }
-        ++n;
-        if (format_first_only) {
-          m = mr.suffix().length();
-          break;
-        }
+    return _regex_count(_bounded_range(regex_range(s, re, flags), _regex_count_limit(flags)), s);
+  }
+
+  // clang-format off
+  template <class CharT, class ST, class Re>
+  requires regex_engine<Re, typename std::basic_string_view<CharT, ST>::iterator>
+  std::pair<std::ptrdiff_t, std::ptrdiff_t>
+  // clang-format on
+  regex_count(std::basic_string_view<CharT, ST> s, const Re& re,
+              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return _regex_count(_bounded_range(regex_range(s, re, flags), _regex_count_limit(flags)), s);
+  }
+} // namespace strtpl::regex::inline STRTPL_INSTRUMENTATION_NAMESPACE
+
+namespace strtpl::regex::inline STRTPL_INSTRUMENTATION_NAMESPACE::v2 {
+
+  // _whole_or_view
+  // 一致があれば base の断片を、無ければ入力全体を一つの断片として返す input_range
+
+  template <std::ranges::view View, class StringView>
+  class _whole_or_view : public std::ranges::view_interface<_whole_or_view<View, StringView>> {
+  private:
+    View base_;
+    StringView whole_;
+    bool use_whole_;
+
+    class iterator {
+    private:
+      _whole_or_view* parent_ = nullptr;
+      std::ranges::iterator_t<View> it_{};
+      bool done_ = false;
+
+    public:
+      using value_type = StringView;
+      using difference_type = std::ptrdiff_t;
+
+      iterator() = default;
+      explicit iterator(_whole_or_view& parent)
+        : parent_(&parent), it_(std::ranges::begin(parent.base_)) {}
+
+      StringView
+      operator*() const {
+        return parent_->use_whole_ ? parent_->whole_ : StringView(*it_);
+      }
+      iterator&
+      operator++() {
+        if (parent_->use_whole_)
+          done_ = true;
+        else
+          ++it_;
+        return *this;
+      }
+      void
+      operator++(int) {
+        ++*this;
       }
+
+      bool
+      operator==(std::default_sentinel_t) const {
+        return parent_->use_whole_ ? done_ : it_ == std::ranges::end(parent_->base_);
+      }
+    };
+
+  public:
+    _whole_or_view(View base, StringView whole, bool use_whole)
+      : base_(std::move(base)), whole_(whole), use_whole_(use_whole) {}
+
+    iterator
+    begin() {
+      return iterator(*this);
     }
-    return {n, m};
-  } */
-} // namespace strtpl::regex
+    std::default_sentinel_t
+    end() const noexcept {
+      return std::default_sentinel;
+    }
+  };
 
-namespace strtpl::regex::v2 {
+  template <class StringView, class Range, class Fn>
+  auto
+  _regex_replace_fn(StringView s, Range&& rng, Fn fn,
+                    std::regex_constants::match_flag_type flags) {
+    STRTPL_INSTRUMENT_ADD(replacements, 1);
+    // regex_range は構築時に最初の一致を探しているため、一致の有無はここで分かる
+    const bool none = std::ranges::empty(rng);
+    const bool format_copy = !(flags & std::regex_constants::format_no_copy);
+    const auto gn = [fn = std::move(fn), format_copy](const auto& x) mutable {
+      const auto& [mr, last] = x;
+      using string_view_type = std::invoke_result_t<Fn&, decltype(mr)>;
+      STRTPL_INSTRUMENT_ADD(matches, last ? 0 : 1);
+      // 要素ごとに std::vector を確保しないよう、固定長の配列で断片を返す
+      // format_no_copy ならば一致しなかった部分を長さ 0 の断片にする
+      const auto part = [format_copy](const auto& sub) {
+        return format_copy ? string_view_type(std::to_address(sub.first),
+                                              static_cast<std::size_t>(sub.length()))
+                           : string_view_type();
+      };
+      if (last)
+        return std::array<string_view_type, 2>{part(mr.suffix()), string_view_type()};
+      return std::array<string_view_type, 2>{part(mr.prefix()),
+                                             string_view_type(std::invoke(fn, mr))};
+    };
+    auto chunks = trailing_view(std::forward<Range>(rng), 2)
+                  | std::views::transform(std::move(gn)) | std::views::join;
+    return _whole_or_view<decltype(chunks), StringView>(std::move(chunks),
+                                                        format_copy ? s : StringView(), none);
+  }
 
   // another version of regex_replace_fn
-  // match がないときは empty view を返す
+  // 置換結果を文字列にまとめずに、出力の断片 (一致の前の部分文字列, 置換文字列, 最後の一致の後の部分文字列)
+  // を順に返す input_range を返す。断片は std::basic_string_view で、長さ 0 のものも含まれる。
+  // fn の戻り値は書式として解釈せず、そのまま出力する。
+  // format_first_only ならば最初の一致だけを置換し、format_no_copy ならば一致しなかった部分
+  // (一致の前後と、一致が無いときの入力全体) を長さ 0 の断片にする (std::regex_replace と同じ)。
+  // match がないときは入力全体を一つの断片として返す (regex_split と異なり、書き出せば入力と一致する)
 
-  /* // clang-format off
+  // clang-format off
   template <class Traits, class CharT, class ST, class Fn>
   requires regex_replace_fn_constraint<CharT, ST, Fn>
   auto
@@ -146,49 +385,129 @@ namespace strtpl::regex::v2 {
   regex_replace_fn(
     std::basic_string_view<CharT, ST> s, const std::basic_regex<CharT, Traits>& re, Fn fn,
     std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
-    const auto gn = [&fn](const auto& x) {
-      const auto& [mr, last] = x;
-      if (last) {
-        auto r = std::ranges::subrange(mr.suffix().first, mr.suffix().second);
-        return std::ranges::join_view(std::vector{r}); // crrently error because GCC does not support `owning_view`
-      }
-      auto r1 = std::ranges::subrange(mr.prefix().first, mr.prefix().second);
-      auto r2 = std::ranges::subrange(std::invoke(fn, mr));
-      return std::ranges::join_view(std::vector{r1, r2}); // crrently error because GCC does not support `owning_view`
-    };
-    return trailing_view(regex_range(s, re, flags), 2) | std::views::transform(gn)
-           | std::views::join;
-  } */
+    return _regex_replace_fn(
+      s, _bounded_range(regex_range(s, re, flags), _regex_count_limit(flags)), std::move(fn), flags);
+  }
+
+  // clang-format off
+  template <class CharT, class ST, class Re, class Fn>
+  requires regex_engine<Re, typename std::basic_string_view<CharT, ST>::iterator>
+    and regex_engine_replace_fn_constraint<CharT, ST, Re, Fn>
+  auto
+  // clang-format on
+  regex_replace_fn(
+    std::basic_string_view<CharT, ST> s, const Re& re, Fn fn,
+    std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return _regex_replace_fn(
+      s, _bounded_range(regex_range(s, re, flags), _regex_count_limit(flags)), std::move(fn), flags);
+  }
 
   // regex_split
   // match がないときは empty view を返す
 
-  template <class Traits, class CharT, class ST>
+  template <class Range>
   auto
-  regex_split(std::basic_string_view<CharT, ST> s, const std::basic_regex<CharT, Traits>& re,
-              bool keepend = false,
-              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+  _regex_split(Range&& rng, bool keepend) {
     const auto fn = [keepend](const auto& x) {
       const auto& [mr, last] = x;
       if (last)
         return std::ranges::subrange(mr.suffix().first, mr.suffix().second);
       return std::ranges::subrange(mr.prefix().first, keepend ? mr[0].second : mr.prefix().second);
     };
-    return trailing_view(regex_range(s, re, flags), 2) | std::views::transform(fn);
+    return trailing_view(std::forward<Range>(rng), 2) | std::views::transform(fn);
   }
 
-  /* template <class Traits, class CharT, class ST>
+  template <class Traits, class CharT, class ST>
+  auto
+  regex_split(std::basic_string_view<CharT, ST> s, const std::basic_regex<CharT, Traits>& re,
+              bool keepend = false,
+              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return _regex_split(regex_range(s, re, flags), keepend);
+  }
+
+  // clang-format off
+  template <class CharT, class ST, class Re>
+  requires regex_engine<Re, typename std::basic_string_view<CharT, ST>::iterator>
+  auto
+  // clang-format on
+  regex_split(std::basic_string_view<CharT, ST> s, const Re& re, bool keepend = false,
+              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return _regex_split(regex_range(s, re, flags), keepend);
+  }
+
+  template <basic_fixed_string Pattern, class CharT, class ST>
+  auto
+  regex_split(std::basic_string_view<CharT, ST> s, bool keepend = false,
+              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return v2::regex_split(s, static_regex_v<Pattern>, keepend, flags);
+  }
+
+  // regex_split_n
+  // 高々 n 個の一致で分割し、n 個目の一致より後ろは探索せずにそのまま最後の要素とする。
+  // 要素数は高々 n + 1 で、match がないとき (n == 0 を含む) は empty view を返す
+
+  template <class Traits, class CharT, class ST>
   auto
   regex_split_n(std::basic_string_view<CharT, ST> s, const std::basic_regex<CharT, Traits>& re,
                 std::size_t n, bool keepend = false,
                 std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
-    const auto fn = [keepend](const auto& x) {
-      const auto& [mr, last] = x;
-      if (last)
-        return std::ranges::subrange(mr.suffix().first, mr.suffix().second);
-      return std::ranges::subrange(mr.prefix().first, keepend ? mr[0].second : mr.prefix().second);
-    };
-    return trailing_view(regex_range(s, re, flags) | std::views::take(n), 2)
-           | std::views::transform(fn);
-  } */
-} // namespace strtpl::regex::v2
+    return _regex_split(_bounded_range(regex_range(s, re, flags), n), keepend);
+  }
+
+  // clang-format off
+  template <class CharT, class ST, class Re>
+  requires regex_engine<Re, typename std::basic_string_view<CharT, ST>::iterator>
+  auto
+  // clang-format on
+  regex_split_n(std::basic_string_view<CharT, ST> s, const Re& re, std::size_t n,
+                bool keepend = false,
+                std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return _regex_split(_bounded_range(regex_range(s, re, flags), n), keepend);
+  }
+
+  template <basic_fixed_string Pattern, class CharT, class ST>
+  auto
+  regex_split_n(std::basic_string_view<CharT, ST> s, std::size_t n, bool keepend = false,
+                std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return v2::regex_split_n(s, static_regex_v<Pattern>, n, keepend, flags);
+  }
+
+  // match_limit
+  // regex_count に渡す一致の数の上限。他の多重定義と同じ位置に渡した match_flag_type が
+  // 上限に暗黙に変換されないように、明示的に構築する別の型とする
+
+  struct match_limit {
+    std::size_t value;
+
+    constexpr explicit match_limit(std::size_t n) noexcept : value(n) {}
+  };
+
+  // regex_count
+  // 高々 n 個の一致を数え、一致の数と最後に数えた一致より後ろの部分の長さを組で返す。
+  // n 個目の一致より後ろは探索しない
+
+  template <class Traits, class CharT, class ST>
+  std::pair<std::ptrdiff_t, std::ptrdiff_t>
+  regex_count(std::basic_string_view<CharT, ST> s, const std::basic_regex<CharT, Traits>& re,
+              match_limit n,
+              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return _regex_count(_bounded_range(regex_range(s, re, flags), n.value), s);
+  }
+
+  // clang-format off
+  template <class CharT, class ST, class Re>
+  requires regex_engine<Re, typename std::basic_string_view<CharT, ST>::iterator>
+  std::pair<std::ptrdiff_t, std::ptrdiff_t>
+  // clang-format on
+  regex_count(std::basic_string_view<CharT, ST> s, const Re& re, match_limit n,
+              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return _regex_count(_bounded_range(regex_range(s, re, flags), n.value), s);
+  }
+
+  template <basic_fixed_string Pattern, class CharT, class ST>
+  std::pair<std::ptrdiff_t, std::ptrdiff_t>
+  regex_count(std::basic_string_view<CharT, ST> s, match_limit n,
+              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return v2::regex_count(s, static_regex_v<Pattern>, n, flags);
+  }
+} // namespace strtpl::regex::inline STRTPL_INSTRUMENTATION_NAMESPACE::v2
@@ -0,0 +1,354 @@
+/// @file regex_engine.hpp
+#pragma once
+#include <algorithm>  // std::fill, std::copy, std::ranges::fill
+#include <cassert>
+#include <concepts>   // std::convertible_to, std::same_as
+#include <cstddef>    // std::ptrdiff_t, std::size_t
+#include <iterator>   // std::iterator_traits, std::forward_iterator_tag
+#include <ranges>     // std::ranges::next
+#include <regex>      // std::sub_match, std::regex_constants
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits> // std::is_same_v, std::remove_cvref_t
+#include <utility>
+#include <vector>
+
+namespace strtpl {
+
+  // regex_engine
+  // std::basic_regex の代わりに regex_replace_fn などへ渡せる照合エンジンの要件。
+  // 照合結果は捕捉グループごとの [開始, 終了) の組を first からのオフセットとして
+  // caps に書き込む (caps.size() == 2 * (mark_count() + 1))。一致しなかったグループは -1 とする。
+  // search_from は pos 以降で最も左の一致を、match_at は pos から始まる一致を探す。
+  // flags のうち match_not_null, match_continuous, match_not_bol, match_not_eol を解釈する。
+
+  template <class Re, class BiIter>
+  concept regex_engine = std::bidirectional_iterator<BiIter> and requires(
+    const Re& re, BiIter first, BiIter last, std::ptrdiff_t pos, std::span<std::ptrdiff_t> caps,
+    std::regex_constants::match_flag_type flags) {
+    typename Re::value_type;
+    { re.mark_count() } -> std::convertible_to<std::size_t>;
+    { re.search_from(first, last, pos, caps, flags) } -> std::same_as<bool>;
+    { re.match_at(first, last, pos, caps, flags) } -> std::same_as<bool>;
+  };
+
+  // engine_captures_t
+  // 照合結果の捕捉位置を置く型。捕捉位置の数が定数のエンジンは captures_type (固定長の配列) を持ち、
+  // 照合結果をヒープに置かない。そうでないエンジンでは std::vector
+
+  template <class Re>
+  struct engine_captures {
+    using type = std::vector<std::ptrdiff_t>;
+  };
+
+  template <class Re>
+  requires requires { typename Re::captures_type; }
+  struct engine_captures<Re> {
+    using type = typename Re::captures_type;
+  };
+
+  template <class Re>
+  using engine_captures_t = typename engine_captures<Re>::type;
+
+  // engine_match
+  // regex_engine による照合結果。std::match_results と同じ名前のメンバ関数を持つ
+
+  template <class BiIter, class Captures = std::vector<std::ptrdiff_t>>
+  class engine_match {
+  public:
+    using value_type = std::sub_match<BiIter>;
+    using const_reference = const value_type&;
+    using reference = value_type&;
+    using difference_type = typename std::iterator_traits<BiIter>::difference_type;
+    using size_type = std::size_t;
+    using char_type = typename std::iterator_traits<BiIter>::value_type;
+    using string_type = std::basic_string<char_type>;
+
+  private:
+    BiIter first_ = BiIter();
+    BiIter last_ = BiIter();
+    std::ptrdiff_t prefix_first_ = 0;
+    Captures caps_{};
+    bool ready_ = false;
+
+    template <class, class>
+    friend class engine_iterator;
+
+    constexpr value_type
+    make_sub_match(std::ptrdiff_t i, std::ptrdiff_t j) const {
+      value_type r;
+      r.first = std::ranges::next(first_, i);
+      r.second = std::ranges::next(first_, j);
+      r.matched = i != j;
+      return r;
+    }
+
+  public:
+    engine_match() = default;
+    constexpr engine_match(BiIter first, BiIter last, std::size_t mark_count)
+      : first_(first), last_(last), ready_(true) {
+      if constexpr (std::is_same_v<Captures, std::vector<std::ptrdiff_t>>)
+        caps_.assign(2 * (mark_count + 1), -1);
+      else
+        std::ranges::fill(caps_, -1);
+      assert(caps_.size() == 2 * (mark_count + 1));
+    }
+
+    constexpr bool
+    ready() const noexcept {
+      return ready_;
+    }
+    constexpr size_type
+    size() const noexcept {
+      return ready_ ? caps_.size() / 2 : 0;
+    }
+    constexpr bool
+    empty() const noexcept {
+      return size() == 0;
+    }
+
+    constexpr std::span<std::ptrdiff_t>
+    captures() noexcept {
+      return caps_;
+    }
+    constexpr std::span<const std::ptrdiff_t>
+    captures() const noexcept {
+      return caps_;
+    }
+
+    constexpr value_type
+    operator[](size_type n) const {
+      if (n >= size() or caps_[2 * n] < 0) {
+        value_type r;
+        r.first = r.second = last_;
+        r.matched = false;
+        return r;
+      }
+      auto r = make_sub_match(caps_[2 * n], caps_[2 * n + 1]);
+      r.matched = true;
+      return r;
+    }
+    constexpr difference_type
+    length(size_type n = 0) const {
+      return (*this)[n].length();
+    }
+    constexpr difference_type
+    position(size_type n = 0) const {
+      return n < size() and caps_[2 * n] >= 0 ? caps_[2 * n] : -1;
+    }
+    string_type
+    str(size_type n = 0) const {
+      return (*this)[n].str();
+    }
+    constexpr value_type
+    prefix() const {
+      return make_sub_match(prefix_first_, caps_[0]);
+    }
+    constexpr value_type
+    suffix() const {
+      value_type r;
+      r.first = std::ranges::next(first_, caps_[1]);
+      r.second = last_;
+      r.matched = r.first != r.second;
+      return r;
+    }
+
+    // ECMAScript の置換書式 ($$, $&, $`, $', $n, $nn) を展開する
+    template <class OutputIter>
+    OutputIter
+    format(OutputIter out, const char_type* fmt_first, const char_type* fmt_last,
+           std::regex_constants::match_flag_type = std::regex_constants::format_default) const {
+      const auto copy_sub = [&out](const value_type& m) {
+        out = std::copy(m.first, m.second, out);
+      };
+      const auto digit = [](char_type c) { return char_type('0') <= c and c <= char_type('9'); };
+      for (auto p = fmt_first; p != fmt_last; ++p) {
+        if (*p != char_type('$') or p + 1 == fmt_last) {
+          *out++ = *p;
+          continue;
+        }
+        const char_type c = p[1];
+        if (c == char_type('$')) {
+          *out++ = c;
+          ++p;
+        } else if (c == char_type('&')) {
+          copy_sub((*this)[0]);
+          ++p;
+        } else if (c == char_type('`')) {
+          copy_sub(prefix());
+          ++p;
+        } else if (c == char_type('\'')) {
+          copy_sub(suffix());
+          ++p;
+        } else if (digit(c)) {
+          auto n = static_cast<size_type>(c - char_type('0'));
+          ++p;
+          if (p + 1 != fmt_last and digit(p[1])) {
+            n = n * 10 + static_cast<size_type>(p[1] - char_type('0'));
+            ++p;
+          }
+          if (n < size())
+            copy_sub((*this)[n]);
+        } else {
+          *out++ = *p;
+        }
+      }
+      return out;
+    }
+  }; // class engine_match
+
+  // match_results_format
+  // engine_match は strtpl 名前空間にあるため、ADL によって strtpl::regex からも見つかる
+
+  template <class BiIter, class Captures, class OutputIter, class ST>
+  OutputIter
+  match_results_format(
+    const engine_match<BiIter, Captures>& mr, OutputIter out,
+    std::basic_string_view<typename std::iterator_traits<BiIter>::value_type, ST> fmt,
+    std::regex_constants::match_flag_type flags = std::regex_constants::format_default) {
+    return mr.format(out, fmt.data(), fmt.data() + fmt.size(), flags);
+  }
+
+  // engine_workspace_t
+  // 照合の作業領域を使い回せるエンジンは workspace_type を持ち、search_from と match_at の
+  // 最後の引数にそれを受け取る。そうでないエンジンでは空の型
+
+  template <class Re>
+  struct engine_workspace {
+    struct type {};
+  };
+
+  template <class Re>
+  requires requires { typename Re::workspace_type; }
+  struct engine_workspace<Re> {
+    using type = typename Re::workspace_type;
+  };
+
+  template <class Re>
+  using engine_workspace_t = typename engine_workspace<Re>::type;
+
+  // engine_match_t
+  // Re による照合結果の型
+
+  template <class BiIter, class Re>
+  using engine_match_t = engine_match<BiIter, engine_captures_t<Re>>;
+
+  // engine_iterator
+  // std::regex_iterator と同じ規則で一致を列挙する。
+  // エンジンが workspace_type を持てば、一つの作業領域を全ての照合で使い回す
+
+  template <class BiIter, class Re>
+  class engine_iterator {
+  public:
+    using value_type = engine_match_t<BiIter, Re>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+    using iterator_category = std::forward_iterator_tag;
+
+  private:
+    BiIter first_ = BiIter();
+    BiIter last_ = BiIter();
+    const Re* re_ = nullptr;
+    std::regex_constants::match_flag_type flags_ = std::regex_constants::match_default;
+    value_type match_{};
+    [[no_unique_address]] engine_workspace_t<Re> ws_{};
+
+    static constexpr bool has_workspace = requires { typename Re::workspace_type; };
+
+    constexpr bool
+    search_from(std::ptrdiff_t pos, std::regex_constants::match_flag_type flags) {
+      if constexpr (has_workspace)
+        return re_->search_from(first_, last_, pos, match_.captures(), flags, ws_);
+      else
+        return re_->search_from(first_, last_, pos, match_.captures(), flags);
+    }
+    constexpr bool
+    match_at(std::ptrdiff_t pos, std::regex_constants::match_flag_type flags) {
+      if constexpr (has_workspace)
+        return re_->match_at(first_, last_, pos, match_.captures(), flags, ws_);
+      else
+        return re_->match_at(first_, last_, pos, match_.captures(), flags);
+    }
+    constexpr void
+    search(std::ptrdiff_t pos, std::regex_constants::match_flag_type flags) {
+      if (not search_from(pos, flags))
+        re_ = nullptr;
+    }
+
+  public:
+    engine_iterator() = default;
+    constexpr engine_iterator(BiIter first, BiIter last, const Re& re,
+                              std::regex_constants::match_flag_type flags =
+                                std::regex_constants::match_default)
+      : first_(first), last_(last), re_(std::addressof(re)), flags_(flags),
+        match_(first, last, static_cast<std::size_t>(re.mark_count())) {
+      search(0, flags_);
+    }
+    engine_iterator(BiIter, BiIter, const Re&&,
+                    std::regex_constants::match_flag_type = std::regex_constants::match_default) =
+      delete;
+
+    constexpr reference
+    operator*() const noexcept {
+      return match_;
+    }
+    constexpr pointer
+    operator->() const noexcept {
+      return std::addressof(match_);
+    }
+
+    constexpr engine_iterator&
+    operator++() {
+      const auto caps = match_.captures();
+      const std::ptrdiff_t start = caps[1];
+      match_.prefix_first_ = start;
+      if (caps[0] == caps[1]) {
+        if (std::ranges::next(first_, start) == last_) {
+          re_ = nullptr;
+          return *this;
+        }
+        if (match_at(start, flags_ | std::regex_constants::match_not_null
+                              | std::regex_constants::match_continuous
+                              | std::regex_constants::match_prev_avail))
+          return *this;
+        search(start + 1, flags_ | std::regex_constants::match_prev_avail);
+      } else {
+        search(start, flags_ | std::regex_constants::match_prev_avail);
+      }
+      return *this;
+    }
+    constexpr engine_iterator
+    operator++(int) {
+      auto tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    friend constexpr bool
+    operator==(const engine_iterator& x, const engine_iterator& y) {
+      if (x.re_ == nullptr or y.re_ == nullptr)
+        return x.re_ == y.re_;
+      return x.first_ == y.first_ and x.last_ == y.last_ and x.re_ == y.re_
+             and x.flags_ == y.flags_ and x.match_.captures()[0] == y.match_.captures()[0]
+             and x.match_.captures()[1] == y.match_.captures()[1];
+    }
+  }; // class engine_iterator
+
+  // regex_iterator_for
+  // 照合エンジンに対応する regex_iterator の型
+
+  template <class BiIter, class Re>
+  struct regex_iterator_for {
+    using type = engine_iterator<BiIter, Re>;
+  };
+
+  template <class BiIter, class CharT, class Traits>
+  struct regex_iterator_for<BiIter, std::basic_regex<CharT, Traits>> {
+    using type = std::regex_iterator<BiIter, CharT, Traits>;
+  };
+
+  template <class BiIter, class Re>
+  using regex_iterator_for_t = typename regex_iterator_for<BiIter, std::remove_cvref_t<Re>>::type;
+} // namespace strtpl
@@ -0,0 +1,148 @@
+/// @file render_chunks.hpp
+#pragma once
+#include <cassert>
+#include <cstddef> // std::size_t
+#include <regex>
+#include <stdexcept> // std::invalid_argument, std::runtime_error
+#include <string>
+#include <string_view>
+#include <vector>
+#include <strtpl/escape.hpp>
+#include <strtpl/generator.hpp>
+#include <strtpl/instrumentation.hpp>
+#include <strtpl/parsed_template.hpp>
+#include <strtpl/regex_engine.hpp>
+#include <strtpl/string_template.hpp>
+
+namespace strtpl::inline STRTPL_INSTRUMENTATION_NAMESPACE {
+
+  // render_chunks
+  // 置換の結果を max_chunk 以下の長さの断片に分けて順に返す generator。
+  // 断片は template の literal 部分か map の値を直接指す string_view で、文字をコピーしない。
+  // 断片ごとに実行を中断するため、呼び出し側は断片を書き込むたびに (socket の送信などを待って)
+  // 次の断片を要求でき、全体を文字列として組み立てる必要が無い。
+  // 断片は次の断片を要求するまで有効で、template の文字列と map は generator より長く生存しなければ
+  // ならない。一時的な map は文の終わりで破棄され断片が dangling になるため、右辺値の map を取る
+  // 版は削除している。
+
+  inline constexpr std::size_t default_chunk_size = 4096;
+
+  // 解析済みの template では、最初の断片を返す前に全ての key を引く (見つからなければ何も返さずに
+  // 送出する)。最初の断片までの時間は template の大きさに依らない。
+  // エスケープする値だけは generator の持つ領域に書き込んでから返す。section には対応しない
+
+  template <class CharT, class ST, class Map>
+  requires map_with_key_type<const Map, std::basic_string_view<CharT, ST>>
+  generator<std::basic_string_view<CharT, ST>>
+  render_chunks(basic_template_view<CharT, ST> t, const Map& map,
+                std::size_t max_chunk = default_chunk_size, escape policy = escape::none) {
+    assert(max_chunk != 0);
+    using string_view_type = std::basic_string_view<CharT, ST>;
+    STRTPL_INSTRUMENT_ADD(renders, 1);
+    if (not escape_supported<CharT>(policy))
+      throw std::invalid_argument("Error: escape not supported for this character type");
+    std::vector<string_view_type> values(t.key_count());
+    t.resolve(map, values);
+    std::basic_string<CharT, ST> buf;
+    for (const auto& seg : t.segments()) {
+      string_view_type s;
+      if (seg.key == template_segment::literal) {
+        s = t.source().substr(seg.offset, seg.length);
+      } else if (const auto e = seg.filter_or(policy); e == escape::none) {
+        s = values[seg.key];
+      } else {
+        buf.resize(escaped_size(e, values[seg.key]));
+        escape_to(e, values[seg.key], buf.data());
+        s = buf;
+      }
+      for (; s.size() > max_chunk; s.remove_prefix(max_chunk))
+        co_yield s.substr(0, max_chunk);
+      if (not s.empty())
+        co_yield s;
+    }
+  }
+
+  template <class CharT, class ST, class Map>
+  generator<std::basic_string_view<CharT, ST>>
+  render_chunks(basic_template_view<CharT, ST> t, const Map&& map,
+                std::size_t max_chunk = default_chunk_size, escape policy = escape::none) = delete;
+
+  template <class CharT, class ST, class Map>
+  requires map_with_key_type<const Map, std::basic_string_view<CharT, ST>>
+  generator<std::basic_string_view<CharT, ST>>
+  render_chunks(const basic_parsed_template<CharT, ST>& t, const Map& map,
+                std::size_t max_chunk = default_chunk_size, escape policy = escape::none) {
+    return render_chunks(t.view(), map, max_chunk, policy);
+  }
+
+  template <class CharT, class ST, class Map>
+  generator<std::basic_string_view<CharT, ST>>
+  render_chunks(const basic_parsed_template<CharT, ST>& t, const Map&& map,
+                std::size_t max_chunk = default_chunk_size, escape policy = escape::none) = delete;
+
+  // 断片は template を指すため、一時的な basic_parsed_template からは作らない
+  template <class CharT, class ST, class Map>
+  generator<std::basic_string_view<CharT, ST>>
+  render_chunks(basic_parsed_template<CharT, ST>&& t, const Map& map,
+                std::size_t max_chunk = default_chunk_size, escape policy = escape::none) = delete;
+
+  // basic_string_template では正規表現の一致を一つずつ探しながら返す。
+  // key は placeholder に達したときに引くため、見つからない key があれば、それより前の断片を
+  // 返した後に送出する。最初の断片までの時間は最初の placeholder までの距離に比例する
+
+  template <class CharT, class ST, class Regex, class Map>
+  requires map_with_key_type<const Map, std::basic_string_view<CharT, ST>>
+  generator<std::basic_string_view<CharT, ST>>
+  render_chunks(basic_string_template<CharT, ST, Regex> tpl, std::basic_string_view<CharT, ST> s,
+                const Map& map, std::size_t max_chunk = default_chunk_size) {
+    assert(max_chunk != 0);
+    using string_view_type = std::basic_string_view<CharT, ST>;
+    using BiIter = typename string_view_type::iterator;
+    using Iter = regex_iterator_for_t<BiIter, Regex>;
+    STRTPL_INSTRUMENT_ADD(renders, 1);
+    const Regex re = tpl.regex();
+    const auto slice = [&s](BiIter first, BiIter last) {
+      return s.substr(static_cast<std::size_t>(first - s.begin()),
+                      static_cast<std::size_t>(last - first));
+    };
+
+    BiIter last = s.begin();
+    for (Iter i(s.begin(), s.end(), re, tpl.match_flags()), end; i != end; ++i) {
+      const auto& mo = *i;
+      auto prefix = slice(last, mo[0].first);
+      last = mo[0].second;
+      for (; prefix.size() > max_chunk; prefix.remove_prefix(max_chunk))
+        co_yield prefix.substr(0, max_chunk);
+      if (not prefix.empty())
+        co_yield prefix;
+      string_view_type value;
+      if (mo[1].matched) {
+        value = string_view_type(at(map, slice(mo[1].first, mo[1].second)));
+        STRTPL_INSTRUMENT_ADD(placeholders, 1);
+      } else if (mo[2].matched) {
+        value = string_view_type(at(map, slice(mo[2].first, mo[2].second)));
+        STRTPL_INSTRUMENT_ADD(placeholders, 1);
+      } else if (mo[3].matched) {
+        value = slice(mo[3].first, mo[3].second);
+      } else if (mo[4].matched) {
+        _invalid(s.begin(), mo[0].first);
+      } else {
+        throw std::runtime_error("Unrecognized group in pattern");
+      }
+      for (; value.size() > max_chunk; value.remove_prefix(max_chunk))
+        co_yield value.substr(0, max_chunk);
+      if (not value.empty())
+        co_yield value;
+    }
+    auto rest = slice(last, s.end());
+    for (; rest.size() > max_chunk; rest.remove_prefix(max_chunk))
+      co_yield rest.substr(0, max_chunk);
+    if (not rest.empty())
+      co_yield rest;
+  }
+
+  template <class CharT, class ST, class Regex, class Map>
+  generator<std::basic_string_view<CharT, ST>>
+  render_chunks(basic_string_template<CharT, ST, Regex> tpl, std::basic_string_view<CharT, ST> s,
+                const Map&& map, std::size_t max_chunk = default_chunk_size) = delete;
+} // namespace strtpl::inline STRTPL_INSTRUMENTATION_NAMESPACE
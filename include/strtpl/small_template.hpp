@@ -0,0 +1,203 @@
+/// @file small_template.hpp
+#pragma once
+#include <cstddef>   // std::size_t
+#include <stdexcept> // std::length_error
+#include <string>
+#include <string_view>
+#include <type_traits> // std::is_same_v, std::make_unsigned_t
+#include <strtpl/identifier.hpp>
+#include <strtpl/instrumentation.hpp>
+#include <strtpl/string_template.hpp>
+
+namespace strtpl::inline STRTPL_INSTRUMENTATION_NAMESPACE {
+
+  // basic_inline_string
+  // 最大 N 個のコード単位を自身の中に持つ固定容量の文字列。ヒープを使わず、常に NUL で終端する。
+  // 容量を超えて追加すると std::length_error を送出する
+
+  template <class CharT, std::size_t N, class ST = std::char_traits<CharT>>
+  class basic_inline_string {
+  public:
+    using traits_type = ST;
+    using value_type = CharT;
+    using size_type = std::size_t;
+    using string_view_type = std::basic_string_view<CharT, ST>;
+    using const_iterator = const CharT*;
+    using iterator = const_iterator;
+
+  private:
+    size_type size_ = 0;
+    CharT data_[N + 1];
+
+  public:
+    basic_inline_string() noexcept {
+      data_[0] = CharT();
+    }
+    explicit basic_inline_string(string_view_type s) : basic_inline_string() {
+      append(s);
+    }
+
+    static constexpr size_type
+    capacity() noexcept {
+      return N;
+    }
+    size_type
+    size() const noexcept {
+      return size_;
+    }
+    bool
+    empty() const noexcept {
+      return size_ == 0;
+    }
+    const CharT*
+    data() const noexcept {
+      return data_;
+    }
+    const CharT*
+    c_str() const noexcept {
+      return data_;
+    }
+    const_iterator
+    begin() const noexcept {
+      return data_;
+    }
+    const_iterator
+    end() const noexcept {
+      return data_ + size_;
+    }
+    string_view_type
+    view() const noexcept {
+      return string_view_type(data_, size_);
+    }
+    operator string_view_type() const noexcept {
+      return view();
+    }
+    std::basic_string<CharT, ST>
+    str() const {
+      return std::basic_string<CharT, ST>(view());
+    }
+
+    basic_inline_string&
+    append(string_view_type s) {
+      if (s.size() > N - size_)
+        throw std::length_error("Error: inline string capacity exceeded");
+      // 短い並びは memmove を呼ばずにコピーする
+      CharT* out = data_ + size_;
+      if (s.size() >= 32)
+        ST::copy(out, s.data(), s.size());
+      else
+        for (const CharT c : s)
+          *out++ = c;
+      size_ += s.size();
+      data_[size_] = CharT();
+      return *this;
+    }
+    basic_inline_string&
+    push_back(CharT c) {
+      return append(string_view_type(&c, 1));
+    }
+    void
+    clear() noexcept {
+      size_ = 0;
+      data_[0] = CharT();
+    }
+
+    friend bool
+    operator==(const basic_inline_string& x, string_view_type y) noexcept {
+      return x.view() == y;
+    }
+  };
+
+  template <std::size_t N>
+  using inline_string = basic_inline_string<char, N>;
+  template <std::size_t N>
+  using winline_string = basic_inline_string<wchar_t, N>;
+  template <std::size_t N>
+  using u8inline_string = basic_inline_string<char8_t, N>;
+  template <std::size_t N>
+  using u16inline_string = basic_inline_string<char16_t, N>;
+  template <std::size_t N>
+  using u32inline_string = basic_inline_string<char32_t, N>;
+
+  namespace _small {
+    // substitute などの識別子の規則。p が識別子の文字 (start ならば先頭の文字) ならばその
+    // コード単位の数を、そうでなければ 0 を返す。Unicode の文字型では identifier.hpp の規則で
+    // ASCII 以外の文字も識別子に含める
+    template <class CharT>
+    constexpr std::size_t
+    id_length(const CharT* p, const CharT* last, bool start) noexcept {
+      const auto u = static_cast<std::make_unsigned_t<CharT>>(*p);
+      if (u < 0x80) {
+        const bool alpha = u == '_' or ((u | 0x20) >= 'a' and (u | 0x20) <= 'z');
+        return alpha or (not start and u >= '0' and u <= '9') ? 1 : 0;
+      }
+      if constexpr (std::is_same_v<CharT, char> or std::is_same_v<CharT, wchar_t>)
+        return 0;
+      else
+        return identifier_length(p, last);
+    }
+
+    // [p, last) の先頭の識別子の終わり。識別子でなければ p
+    template <class CharT>
+    constexpr const CharT*
+    id_end(const CharT* p, const CharT* last) noexcept {
+      if (p == last)
+        return p;
+      std::size_t n = id_length(p, last, true);
+      while (n != 0) {
+        p += n;
+        n = p == last ? 0 : id_length(p, last, false);
+      }
+      return p;
+    }
+  } // namespace _small
+
+  // render_small
+  // ログやメトリクスのラベルのような短い template のための substitute(s, map)。
+  // 正規表現を使わずに substitute, wsubstitute, u8substitute などと同じ規則 ($name, ${name}, $$) で
+  // 次の "$" を traits_type::find で探しながら走査し、結果を basic_inline_string<CharT, N> に書く。
+  // map がヒープを使わなければ一度もヒープを確保しない。
+  // 見つからない key と不正な placeholder は substitute と同じ例外を、結果が N を超えると
+  // std::length_error を送出する。区切りや識別子の規則を変えた template には使えない。
+  // 値は substitute と異なり書式として解釈せずにそのままコピーする
+
+  template <std::size_t N = 256, class CharT, class ST, class Map>
+  requires map_with_key_type<const Map, std::basic_string_view<CharT, ST>>
+  basic_inline_string<CharT, N, ST>
+  render_small(std::basic_string_view<CharT, ST> s, const Map& map) {
+    using string_view_type = std::basic_string_view<CharT, ST>;
+    STRTPL_INSTRUMENT_ADD(renders, 1);
+    basic_inline_string<CharT, N, ST> r;
+    const CharT* p = s.data();
+    const CharT* const last = p + s.size();
+    const auto put = [&r, &map](const CharT* first, const CharT* end) {
+      const string_view_type key(first, static_cast<std::size_t>(end - first));
+      r.append(string_view_type(at(map, key)));
+      STRTPL_INSTRUMENT_ADD(placeholders, 1);
+    };
+    while (const CharT* d = ST::find(p, static_cast<std::size_t>(last - p), CharT('$'))) {
+      r.append(string_view_type(p, static_cast<std::size_t>(d - p)));
+      const CharT* q = d + 1;
+      if (const CharT* id = _small::id_end(q, last); id != q) {
+        put(q, id);
+        p = id;
+      } else if (q != last and *q == CharT('$')) {
+        r.push_back(CharT('$'));
+        p = q + 1;
+      } else {
+        if (q != last and *q == CharT('{')) {
+          q = _small::id_end(d + 2, last);
+          if (q != d + 2 and q != last and *q == CharT('}')) {
+            put(d + 2, q);
+            p = q + 1;
+            continue;
+          }
+        }
+        _invalid(s.begin(), s.begin() + (d - s.data()));
+      }
+    }
+    r.append(string_view_type(p, static_cast<std::size_t>(last - p)));
+    STRTPL_INSTRUMENT_ADD(output_bytes, r.size() * sizeof(CharT));
+    return r;
+  }
+} // namespace strtpl::inline STRTPL_INSTRUMENTATION_NAMESPACE
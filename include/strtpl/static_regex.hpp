@@ -0,0 +1,120 @@
+/// @file static_regex.hpp
+#pragma once
+#include <algorithm> // std::copy
+#include <array>
+#include <cstddef> // std::ptrdiff_t, std::size_t
+#include <cstdint> // std::uint32_t
+#include <regex>   // std::regex_constants
+#include <span>
+#include <string_view>
+#include <type_traits> // std::remove_cvref_t
+#include <strtpl/nfa_regex.hpp>
+
+namespace strtpl {
+
+  // basic_fixed_string
+  // 文字列リテラルを非型テンプレート引数として渡すための型
+
+  template <class CharT, std::size_t N>
+  struct basic_fixed_string {
+    CharT data_[N] = {};
+
+    constexpr basic_fixed_string(const CharT (&s)[N]) noexcept {
+      std::copy(s, s + N, data_);
+    }
+
+    constexpr std::size_t
+    size() const noexcept {
+      return N - 1;
+    }
+    constexpr std::basic_string_view<CharT>
+    view() const noexcept {
+      return {data_, N - 1};
+    }
+  };
+
+  // static_regex
+  // 正規表現をコンパイル時に nfa_program へ変換し、固定長の配列に格納する。
+  // 実行時に正規表現オブジェクトを構築しないだけで、照合は basic_nfa_regex と同じ汎用の Pike VM
+  // (nfa_execute) が行い、パターンごとに特殊化した照合器は生成しない。構文と照合の意味も同じである。
+  // 作業領域 (workspace_type) と照合結果の捕捉位置 (captures_type) は大きさが定数の配列で、
+  // engine_iterator はどちらもヒープに置かない。作業領域は命令数と捕捉位置の数の積に比例する大きさを
+  // イテレータの中 (workspace_type を受け取らない呼び出しではスタック) に置き、照合のたびではなく
+  // イテレータの構築時に一度だけ初期化する。
+
+  template <basic_fixed_string Pattern>
+  class static_regex {
+  public:
+    using value_type = std::remove_cvref_t<decltype(Pattern.data_[0])>;
+
+  private:
+    static constexpr std::size_t ninsts = nfa_compile(Pattern.view()).insts.size();
+    static constexpr std::size_t nranges = nfa_compile(Pattern.view()).ranges.size();
+    static constexpr std::size_t ncaps = 2 * (nfa_compile(Pattern.view()).mark_count + 1);
+
+    struct program_type {
+      std::array<nfa_inst, ninsts> insts{};
+      // 長さ 0 の配列を避ける
+      std::array<nfa_range, nranges + 1> ranges{};
+    };
+
+    static constexpr program_type program_ = [] {
+      const auto prog = nfa_compile(Pattern.view());
+      program_type r;
+      std::ranges::copy(prog.insts, r.insts.begin());
+      std::ranges::copy(prog.ranges, r.ranges.begin());
+      return r;
+    }();
+
+  public:
+    using captures_type = std::array<std::ptrdiff_t, ncaps>;
+
+    struct workspace_type {
+      std::array<std::uint32_t, 4 * ninsts> sets{};
+      std::array<std::ptrdiff_t, (2 * ninsts + 1) * ncaps> caps{};
+      std::array<nfa_stack_entry, 2 * ninsts + 1> stack{};
+    };
+
+    static constexpr std::size_t
+    mark_count() noexcept {
+      return ncaps / 2 - 1;
+    }
+
+    template <class BiIter>
+    constexpr bool
+    search_from(BiIter first, BiIter last, std::ptrdiff_t pos, std::span<std::ptrdiff_t> caps,
+                std::regex_constants::match_flag_type flags, workspace_type& ws) const {
+      const nfa_scratch sc{ws.sets.data(), ws.sets.data() + 2 * ninsts, ws.caps.data(),
+                           ws.caps.data() + 2 * ninsts * ncaps, ws.stack.data()};
+      return nfa_execute(std::span<const nfa_inst>(program_.insts),
+                         std::span<const nfa_range>(program_.ranges), sc, first, last, pos,
+                         caps.first(ncaps), flags);
+    }
+    template <class BiIter>
+    constexpr bool
+    search_from(BiIter first, BiIter last, std::ptrdiff_t pos, std::span<std::ptrdiff_t> caps,
+                std::regex_constants::match_flag_type flags =
+                  std::regex_constants::match_default) const {
+      workspace_type ws;
+      return search_from(first, last, pos, caps, flags, ws);
+    }
+    template <class BiIter>
+    constexpr bool
+    match_at(BiIter first, BiIter last, std::ptrdiff_t pos, std::span<std::ptrdiff_t> caps,
+             std::regex_constants::match_flag_type flags, workspace_type& ws) const {
+      return search_from(first, last, pos, caps, flags | std::regex_constants::match_continuous,
+                         ws);
+    }
+    template <class BiIter>
+    constexpr bool
+    match_at(BiIter first, BiIter last, std::ptrdiff_t pos, std::span<std::ptrdiff_t> caps,
+             std::regex_constants::match_flag_type flags =
+               std::regex_constants::match_default) const {
+      return search_from(first, last, pos, caps, flags | std::regex_constants::match_continuous);
+    }
+  }; // class static_regex
+
+  // 返された view が正規表現を参照し続けられるよう、静的記憶域に置く
+  template <basic_fixed_string Pattern>
+  inline constexpr static_regex<Pattern> static_regex_v{};
+} // namespace strtpl
@@ -1,4 +1,5 @@
 /// @file string_template.hpp
+#pragma once
 #include <algorithm>  // std::copy
 #include <exception>  // std::out_of_range, std::runtime_error
 #include <functional> // std::invoke
@@ -8,8 +9,12 @@
 #include <string_view>
 #include <type_traits> // std::remove_cvref_t
 #include <utility>
+#include <strtpl/instrumentation.hpp>
+#include <strtpl/nfa_regex.hpp>
+#include <strtpl/regex_engine.hpp>
+#include <strtpl/static_regex.hpp>
 
-namespace strtpl {
+namespace strtpl::inline STRTPL_INSTRUMENTATION_NAMESPACE {
 
   // TYPED_LITERAL
   // See https://github.com/microsoft/STL/blob/17fde2cbab6e8724d81c9555237c9a623d7fb954/tests/std/tests/P0220R1_string_view/test.cpp#L260-L277
@@ -20,7 +25,7 @@ namespace strtpl {
   template <>
   struct choose_literal<char> {
     static constexpr const char*
-    choose(const char* s, const wchar_t*) {
+    choose(const char* s, const wchar_t*, const char8_t*, const char16_t*, const char32_t*) {
       return s;
     }
   };
@@ -28,12 +33,59 @@ namespace strtpl {
   template <>
   struct choose_literal<wchar_t> {
     static constexpr const wchar_t*
-    choose(const char*, const wchar_t* s) {
+    choose(const char*, const wchar_t* s, const char8_t*, const char16_t*, const char32_t*) {
       return s;
     }
   };
 
-#define TYPED_LITERAL(CharT, Literal) (choose_literal<CharT>::choose(Literal, L##Literal))
+  template <>
+  struct choose_literal<char8_t> {
+    static constexpr const char8_t*
+    choose(const char*, const wchar_t*, const char8_t* s, const char16_t*, const char32_t*) {
+      return s;
+    }
+  };
+
+  template <>
+  struct choose_literal<char16_t> {
+    static constexpr const char16_t*
+    choose(const char*, const wchar_t*, const char8_t*, const char16_t* s, const char32_t*) {
+      return s;
+    }
+  };
+
+  template <>
+  struct choose_literal<char32_t> {
+    static constexpr const char32_t*
+    choose(const char*, const wchar_t*, const char8_t*, const char16_t*, const char32_t* s) {
+      return s;
+    }
+  };
+
+#define TYPED_LITERAL(CharT, Literal)                                                              \
+  (choose_literal<CharT>::choose(Literal, L##Literal, u8##Literal, u##Literal, U##Literal))
+
+  // default_regex_t
+  // libstdc++ などの std::basic_regex は char と wchar_t にしか対応しないため、
+  // それ以外の文字型では basic_nfa_regex を使う
+
+  template <class CharT>
+  struct default_regex {
+    using type = basic_nfa_regex<CharT>;
+  };
+
+  template <>
+  struct default_regex<char> {
+    using type = std::basic_regex<char>;
+  };
+
+  template <>
+  struct default_regex<wchar_t> {
+    using type = std::basic_regex<wchar_t>;
+  };
+
+  template <class CharT>
+  using default_regex_t = typename default_regex<CharT>::type;
 
   // match_results_format
 
@@ -47,19 +99,32 @@ namespace strtpl {
   }
 
   // regex_escape
+  // ECMAScript の構文で特別な意味を持つ文字の前に '\' を挿入する。
+  // 正規表現を使わずにコード単位ごとに判定するため、全ての文字型に対応する
 
   template <class CharT, class ST>
   std::basic_string<CharT, ST>
-  regex_escape(std::basic_string_view<CharT, ST> s,
-               std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
-    std::basic_string<CharT, ST> r;
+  regex_escape(std::basic_string_view<CharT, ST> s) {
     // See https://developer.mozilla.org/en-US/docs/Web/JavaScript/Guide/Regular_Expressions
-    const std::basic_regex<CharT> re(TYPED_LITERAL(CharT, R"([.*+?^${}()|[\]\\])"));
-    std::regex_replace(std::back_inserter(r), s.begin(), s.end(), re, TYPED_LITERAL(CharT, "\\$&"),
-                       flags);
+    constexpr std::basic_string_view<CharT> special = TYPED_LITERAL(CharT, R"(.*+?^${}()|[]\)");
+    std::basic_string<CharT, ST> r;
+    r.reserve(s.size());
+    for (const CharT c : s) {
+      if (special.find(c) != special.npos)
+        r.push_back(CharT('\\'));
+      r.push_back(c);
+    }
     return r;
   }
 
+  // 以前は std::regex_replace に渡していた flags を受け取る版。flags は何の効果も持たず、
+  // format_first_only を渡しても全ての特殊文字を escape する
+  template <class CharT, class ST>
+  [[deprecated("flags has no effect; call regex_escape(s)")]] std::basic_string<CharT, ST>
+  regex_escape(std::basic_string_view<CharT, ST> s, std::regex_constants::match_flag_type) {
+    return regex_escape(s);
+  }
+
   // regex_replace_fn
 
   template <class T, class CharT>
@@ -75,16 +140,23 @@ namespace strtpl {
                        is_std_basic_string_view_with_char_type<
                          std::invoke_result_t<Fn&, const std::match_results<BiIter>&>, CharT>>;
 
-  // clang-format off
-  template <class OutputIter, class BiIter, class Traits, class CharT, class Fn>
-  requires regex_replace_fn_constraint<BiIter, Traits, CharT, Fn>
+  template <class BiIter, class Re, class Fn>
+  inline constexpr bool regex_engine_replace_fn_constraint = std::conjunction_v<
+    std::is_invocable<Fn&, const engine_match_t<BiIter, Re>&>,
+    is_std_basic_string_view_with_char_type<
+      std::invoke_result_t<Fn&, const engine_match_t<BiIter, Re>&>, typename Re::value_type>>;
+
+  template <class Iter, class OutputIter, class BiIter, class Re, class Fn>
   OutputIter
-  // clang-format on
-  regex_replace_fn(
-    OutputIter out, BiIter first, BiIter last, const std::basic_regex<CharT, Traits>& re, Fn fn,
-    std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
-    using Iter = std::regex_iterator<BiIter, CharT, Traits>;
+  _regex_replace_fn(OutputIter out, BiIter first, BiIter last, const Re& re, Fn& fn,
+                    std::regex_constants::match_flag_type flags) {
+    STRTPL_INSTRUMENT_ADD(replacements, 1);
+    STRTPL_INSTRUMENT_ADD(input_bytes, static_cast<std::size_t>(std::distance(first, last))
+                                         * sizeof(typename std::iterator_traits<BiIter>::value_type));
+    // イテレータの構築時に最初の一致を探索する
+    STRTPL_INSTRUMENT_PHASE_BEGIN(match_ns);
     Iter i(first, last, re, flags);
+    STRTPL_INSTRUMENT_PHASE(copy_ns);
     Iter eof;
     const bool format_copy = !(flags & std::regex_constants::format_no_copy);
     if (i == eof) {
@@ -93,13 +165,17 @@ namespace strtpl {
     } else {
       std::sub_match<BiIter> lm;
       const bool format_first_only = flags & std::regex_constants::format_first_only;
-      for (; i != eof; ++i) {
+      for (; i != eof;) {
+        STRTPL_INSTRUMENT_ADD(matches, 1);
         if (format_copy)
           out = std::copy(i->prefix().first, i->prefix().second, out);
         out = match_results_format(*i, out, std::invoke(fn, *i), flags);
         lm = i->suffix();
         if (format_first_only)
           break;
+        STRTPL_INSTRUMENT_PHASE(match_ns);
+        ++i;
+        STRTPL_INSTRUMENT_PHASE(copy_ns);
       }
       if (format_copy)
         out = std::copy(lm.first, lm.second, out);
@@ -107,6 +183,30 @@ namespace strtpl {
     return out;
   }
 
+  // clang-format off
+  template <class OutputIter, class BiIter, class Traits, class CharT, class Fn>
+  requires regex_replace_fn_constraint<BiIter, Traits, CharT, Fn>
+  OutputIter
+  // clang-format on
+  regex_replace_fn(
+    OutputIter out, BiIter first, BiIter last, const std::basic_regex<CharT, Traits>& re, Fn fn,
+    std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    using Iter = std::regex_iterator<BiIter, CharT, Traits>;
+    return _regex_replace_fn<Iter>(out, first, last, re, fn, flags);
+  }
+
+  // clang-format off
+  template <class OutputIter, class BiIter, class Re, class Fn>
+  requires regex_engine<Re, BiIter> and regex_engine_replace_fn_constraint<BiIter, Re, Fn>
+  OutputIter
+  // clang-format on
+  regex_replace_fn(
+    OutputIter out, BiIter first, BiIter last, const Re& re, Fn fn,
+    std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    using Iter = engine_iterator<BiIter, Re>;
+    return _regex_replace_fn<Iter>(out, first, last, re, fn, flags);
+  }
+
   template <class Traits, class CharT, class ST, class Fn>
   requires regex_replace_fn_constraint<typename std::basic_string_view<CharT, ST>::iterator, Traits,
                                        CharT, Fn>
@@ -115,18 +215,43 @@ namespace strtpl {
       std::basic_string_view<CharT, ST> s, const std::basic_regex<CharT, Traits>& re, Fn fn,
       std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
     std::basic_string<CharT, ST> r;
-    regex_replace_fn(std::back_inserter(r), s.begin(), s.end(), re, fn, flags);
+    regex_replace_fn(instrumentation::string_inserter(r), s.begin(), s.end(), re, fn, flags);
+    STRTPL_INSTRUMENT_ADD(output_bytes, r.size() * sizeof(CharT));
     return r;
   }
 
+  // clang-format off
+  template <class CharT, class ST, class Re, class Fn>
+  requires regex_engine<Re, typename std::basic_string_view<CharT, ST>::iterator>
+    and regex_engine_replace_fn_constraint<typename std::basic_string_view<CharT, ST>::iterator, Re, Fn>
+  std::basic_string<CharT, ST>
+  // clang-format on
+  regex_replace_fn(
+    std::basic_string_view<CharT, ST> s, const Re& re, Fn fn,
+    std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    std::basic_string<CharT, ST> r;
+    regex_replace_fn(instrumentation::string_inserter(r), s.begin(), s.end(), re, fn, flags);
+    STRTPL_INSTRUMENT_ADD(output_bytes, r.size() * sizeof(CharT));
+    return r;
+  }
+
+  // clang-format off
+  template <basic_fixed_string Pattern, class CharT, class ST, class Fn>
+  requires regex_engine_replace_fn_constraint<typename std::basic_string_view<CharT, ST>::iterator,
+                                              static_regex<Pattern>, Fn>
+  std::basic_string<CharT, ST>
+  // clang-format on
+  regex_replace_fn(
+    std::basic_string_view<CharT, ST> s, Fn fn,
+    std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return regex_replace_fn(s, static_regex_v<Pattern>, fn, flags);
+  }
+
   // regex_count
 
-  template <class BiIter, class Traits, class CharT>
+  template <class Iter, class BiIter>
   std::pair<std::ptrdiff_t, std::ptrdiff_t>
-  regex_count(BiIter first, BiIter last, const std::basic_regex<CharT, Traits>& re,
-              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
-    using Iter = std::regex_iterator<BiIter, CharT, Traits>;
-    Iter i(first, last, re, flags);
+  _regex_count(Iter i, BiIter first, BiIter last, std::regex_constants::match_flag_type flags) {
     Iter eof;
     std::ptrdiff_t n = 0, m = 0;
     if (i == eof) {
@@ -145,6 +270,25 @@ namespace strtpl {
     return {n, m};
   }
 
+  template <class BiIter, class Traits, class CharT>
+  std::pair<std::ptrdiff_t, std::ptrdiff_t>
+  regex_count(BiIter first, BiIter last, const std::basic_regex<CharT, Traits>& re,
+              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    using Iter = std::regex_iterator<BiIter, CharT, Traits>;
+    return _regex_count(Iter(first, last, re, flags), first, last, flags);
+  }
+
+  // clang-format off
+  template <class BiIter, class Re>
+  requires regex_engine<Re, BiIter>
+  std::pair<std::ptrdiff_t, std::ptrdiff_t>
+  // clang-format on
+  regex_count(BiIter first, BiIter last, const Re& re,
+              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    using Iter = engine_iterator<BiIter, Re>;
+    return _regex_count(Iter(first, last, re, flags), first, last, flags);
+  }
+
   template <class Traits, class CharT, class ST>
   std::pair<std::ptrdiff_t, std::ptrdiff_t>
   regex_count(std::basic_string_view<CharT, ST> s, const std::basic_regex<CharT, Traits>& re,
@@ -152,6 +296,23 @@ namespace strtpl {
     return regex_count(s.begin(), s.end(), re, flags);
   }
 
+  // clang-format off
+  template <class CharT, class ST, class Re>
+  requires regex_engine<Re, typename std::basic_string_view<CharT, ST>::iterator>
+  std::pair<std::ptrdiff_t, std::ptrdiff_t>
+  // clang-format on
+  regex_count(std::basic_string_view<CharT, ST> s, const Re& re,
+              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return regex_count(s.begin(), s.end(), re, flags);
+  }
+
+  template <basic_fixed_string Pattern, class CharT, class ST>
+  std::pair<std::ptrdiff_t, std::ptrdiff_t>
+  regex_count(std::basic_string_view<CharT, ST> s,
+              std::regex_constants::match_flag_type flags = std::regex_constants::match_default) {
+    return regex_count(s, static_regex_v<Pattern>, flags);
+  }
+
   // substitute
 
   namespace hidden_ops::inline string_view_ops {
@@ -179,22 +340,43 @@ namespace strtpl {
   at(Map& map, const Key& key) {
     auto i = map.find(key);
     using std::end;
-    return i == end(map) ? throw std::out_of_range("Error: key not found") : get<1>(*i);
+    if (i == end(map)) {
+      STRTPL_INSTRUMENT_ADD(missing_keys, 1);
+      throw std::out_of_range("Error: key not found");
+    }
+    return get<1>(*i);
   }
 
   template <class BiIter>
   void
   _invalid(BiIter first, BiIter last) {
     using CharT = typename std::iterator_traits<BiIter>::value_type;
+    STRTPL_INSTRUMENT_ADD(invalid_placeholders, 1);
     // See https://docs.python.org/ja/3/library/stdtypes.html#str.splitlines
-    const std::basic_regex<CharT> re(TYPED_LITERAL(CharT, R"((\r\n?|[\n\v\f]))"));
-    const auto [lineno, colno] = regex_count(first, last, re);
+    // 改行は \r\n, \r, \n, \v, \f で、コード単位を数えるだけなので全ての文字型に対応する
+    std::size_t lineno = 0, colno = 0;
+    for (; first != last; ++first) {
+      const CharT c = *first;
+      if (c == CharT('\r')) {
+        if (std::next(first) != last and *std::next(first) == CharT('\n'))
+          ++first;
+      } else if (c != CharT('\n') and c != CharT('\v') and c != CharT('\f')) {
+        ++colno;
+        continue;
+      }
+      ++lineno;
+      colno = 0;
+    }
     auto msg = "Invalid placeholder in string: line " + std::to_string(lineno + 1) + ", col "
                + std::to_string(colno + 1);
     throw std::runtime_error(std::move(msg));
   }
 
-  template <class CharT, class ST = std::char_traits<CharT>>
+  // basic_string_template
+  // Regex には std::basic_regex の他に regex_engine を満たす型 (basic_nfa_regex など) を指定できる。
+  // 既定は char と wchar_t では std::basic_regex、char8_t, char16_t, char32_t では basic_nfa_regex
+
+  template <class CharT, class ST = std::char_traits<CharT>, class Regex = default_regex_t<CharT>>
   struct basic_string_template {
   private:
     std::basic_string_view<CharT, ST> delimiter{};
@@ -216,53 +398,99 @@ namespace strtpl {
       : delimiter{delim}, idpattern{id}, braceidpattern{bid}, flags{f} {}
     // clang-format on
 
+    // placeholder を探す正規表現とその pattern。捕捉グループは順に idpattern, braceidpattern,
+    // 区切り文字のエスケープ, 不正な placeholder に対応する
+    std::basic_string<CharT, ST>
+    pattern() const;
+    Regex
+    regex() const;
+    constexpr std::regex_constants::match_flag_type
+    match_flags() const noexcept {
+      return flags;
+    }
+
     // clang-format off
     template <class Map>
     requires map_with_key_type<Map, std::basic_string_view<CharT, ST>> and std::convertible_to<
       map_mapped_t<Map, std::basic_string_view<CharT, ST>>, std::basic_string_view<CharT, ST>>
     std::basic_string<CharT, ST>
     // clang-format on
-    operator()(std::basic_string_view<CharT, ST> s, const Map& map) const {
-      const std::basic_regex<CharT> re{[this] {
-        using namespace hidden_ops::string_view_ops;
-        const auto delim = regex_escape(delimiter);
-        const auto escape = TYPED_LITERAL(CharT, "(") + delim + TYPED_LITERAL(CharT, ")");
-        return delim + TYPED_LITERAL(CharT, "(?:") + idpattern + TYPED_LITERAL(CharT, "|\\{")
-               + braceidpattern + TYPED_LITERAL(CharT, "\\}|") + escape + TYPED_LITERAL(CharT, "|")
-               + invalid + TYPED_LITERAL(CharT, ")");
-      }()};
-
-      using string_view_type = std::basic_string_view<CharT, ST>;
-      const auto convert = [&delim = delimiter, first = s.begin(), &map](
-                             const std::match_results<typename string_view_type::iterator>& mo) {
-        if (mo[1].matched) {
-          string_view_type key(std::to_address(mo[1].first),
-                               static_cast<std::size_t>(mo[1].length()));
-          return string_view_type(at(map, key));
-        } else if (mo[2].matched) {
-          string_view_type key(std::to_address(mo[2].first),
-                               static_cast<std::size_t>(mo[2].length()));
-          return string_view_type(at(map, key));
-        } else if (mo[3].matched) {
-          return string_view_type(delim.data(), delim.length());
-        } else if (mo[4].matched) {
-          _invalid(first, mo.prefix().second);
-        }
-        throw std::runtime_error("Unrecognized group in pattern");
-      };
-
-      return regex_replace_fn(s, re, convert, flags);
-    }
+    operator()(std::basic_string_view<CharT, ST> s, const Map& map) const;
   }; // struct basic_string_template
 
+  // 以下はクラスの外で定義し、inline にしない。
+  // compiled.hpp の extern template の宣言があれば、最適化を有効にしても各翻訳単位で実体化しない
+
+  template <class CharT, class ST, class Regex>
+  std::basic_string<CharT, ST>
+  basic_string_template<CharT, ST, Regex>::pattern() const {
+    using namespace hidden_ops::string_view_ops;
+    const auto delim = regex_escape(delimiter);
+    const auto escape = TYPED_LITERAL(CharT, "(") + delim + TYPED_LITERAL(CharT, ")");
+    return delim + TYPED_LITERAL(CharT, "(?:") + idpattern + TYPED_LITERAL(CharT, "|\\{")
+           + braceidpattern + TYPED_LITERAL(CharT, "\\}|") + escape + TYPED_LITERAL(CharT, "|")
+           + invalid + TYPED_LITERAL(CharT, ")");
+  }
+
+  template <class CharT, class ST, class Regex>
+  Regex
+  basic_string_template<CharT, ST, Regex>::regex() const {
+    return Regex{pattern()};
+  }
+
+  // clang-format off
+  template <class CharT, class ST, class Regex>
+  template <class Map>
+  requires map_with_key_type<Map, std::basic_string_view<CharT, ST>> and std::convertible_to<
+    map_mapped_t<Map, std::basic_string_view<CharT, ST>>, std::basic_string_view<CharT, ST>>
+  std::basic_string<CharT, ST>
+  // clang-format on
+  basic_string_template<CharT, ST, Regex>::operator()(std::basic_string_view<CharT, ST> s,
+                                                      const Map& map) const {
+    STRTPL_INSTRUMENT_ADD(renders, 1);
+    const Regex re = regex();
+
+    using string_view_type = std::basic_string_view<CharT, ST>;
+    const auto convert = [&delim = delimiter, first = s.begin(), &map](const auto& mo) {
+      if (mo[1].matched) {
+        string_view_type key(std::to_address(mo[1].first),
+                             static_cast<std::size_t>(mo[1].length()));
+        const string_view_type value(at(map, key));
+        STRTPL_INSTRUMENT_ADD(placeholders, 1);
+        return value;
+      } else if (mo[2].matched) {
+        string_view_type key(std::to_address(mo[2].first),
+                             static_cast<std::size_t>(mo[2].length()));
+        const string_view_type value(at(map, key));
+        STRTPL_INSTRUMENT_ADD(placeholders, 1);
+        return value;
+      } else if (mo[3].matched) {
+        return string_view_type(delim.data(), delim.length());
+      } else if (mo[4].matched) {
+        _invalid(first, mo.prefix().second);
+      }
+      throw std::runtime_error("Unrecognized group in pattern");
+    };
+
+    return regex_replace_fn(s, re, convert, flags);
+  }
+
   using string_template = basic_string_template<char>;
   using wstring_template = basic_string_template<wchar_t>;
+  using u8string_template = basic_string_template<char8_t>;
+  using u16string_template = basic_string_template<char16_t>;
+  using u32string_template = basic_string_template<char32_t>;
 
   inline namespace cpo {
     // See https://github.com/python/cpython/blob/971343eb569a3418aa9a0bad9b638cccf1470ef8/Lib/string.py#L57
     inline constexpr string_template substitute{"$", "([_a-zA-Z][_a-zA-Z0-9]*)"};
     inline constexpr wstring_template wsubstitute{L"$", L"([_a-zA-Z][_a-zA-Z0-9]*)"};
+    // Unicode の文字型では ASCII 以外の文字のうち、空白、句読点、記号などを除いたものも識別子に
+    // 含める (identifier.hpp)。UTF-8 と UTF-16 では符号化の列を一つの文字として判定する
+    inline constexpr u8string_template u8substitute{u8"$", u8R"((\p{ID_Start}\p{ID_Continue}*))"};
+    inline constexpr u16string_template u16substitute{u"$", uR"((\p{ID_Start}\p{ID_Continue}*))"};
+    inline constexpr u32string_template u32substitute{U"$", UR"((\p{ID_Start}\p{ID_Continue}*))"};
   } // namespace cpo
 
 #undef TYPED_LITERAL
-} // namespace strtpl
+} // namespace strtpl::inline STRTPL_INSTRUMENTATION_NAMESPACE
@@ -1,4 +1,8 @@
 /// @file trailing_view.hpp
+#pragma once
+#include <cassert>
+#include <algorithm> // std::min
+#include <compare>
 #include <concepts> // std::semiregular
 #include <iterator> // std::iterator_traits, std::unreachable_sentinel_t
 #include <ranges>
@@ -60,7 +64,7 @@ namespace strtpl {
     constexpr iterator<false>
     end() requires
       std::ranges::common_range<View> and different_from<Bound, std::unreachable_sentinel_t> {
-      return {*this, std::ranges::end(base_), bound_};
+      return {*this, std::default_sentinel};
     }
     constexpr auto
     end() const requires std::ranges::input_range<const View> {
@@ -69,7 +73,7 @@ namespace strtpl {
     constexpr iterator<true>
     end() const requires std::ranges::input_range<const View> and std::ranges::common_range<
       const View> and different_from<Bound, std::unreachable_sentinel_t> {
-      return {*this, std::ranges::end(base_), bound_};
+      return {*this, std::default_sentinel};
     }
 
     constexpr auto
@@ -99,14 +103,22 @@ namespace strtpl {
   template <class View>
   struct trailing_iterator_category {};
 
+  // ランダムアクセスには、要素の残り数を定数時間で求められることが必要
+  template <class View>
+  concept trailing_random_access =
+    std::ranges::random_access_range<View>
+    and std::sized_sentinel_for<std::ranges::sentinel_t<View>, std::ranges::iterator_t<View>>;
+
   template <std::ranges::forward_range View>
   struct trailing_iterator_category<View> {
     using Cat = typename std::iterator_traits<std::ranges::iterator_t<View>>::iterator_category;
     // clang-format off
     using iterator_category =
+      std::conditional_t<std::derived_from<Cat, std::random_access_iterator_tag>
+                           and trailing_random_access<View>,                     std::random_access_iterator_tag,
       std::conditional_t<std::derived_from<Cat, std::bidirectional_iterator_tag>, std::bidirectional_iterator_tag,
       std::conditional_t<std::derived_from<Cat, std::forward_iterator_tag>,       std::forward_iterator_tag,
-      /* else */                                                                  Cat>>;
+      /* else */                                                                  Cat>>>;
     // clang-format on
   };
 
@@ -122,25 +134,34 @@ namespace strtpl {
     using Parent = std::conditional_t<Const, const trailing_view, trailing_view>;
     using Base = std::conditional_t<Const, const View, View>;
 
+    // 親の base() は View を値で返すため、走査中は呼ばずに親の base_ の番兵と比べる。
+    // 基底の範囲が空かどうかはイテレータに保持する
     [[no_unique_address]] Parent* parent_ = nullptr;
     [[no_unique_address]] std::ranges::iterator_t<Base> current_ = std::ranges::iterator_t<Base>();
     [[no_unique_address]] std::ranges::iterator_t<Base> next_ = std::ranges::iterator_t<Base>();
     std::ranges::range_difference_t<Base> ncount_ = 0;
+    bool empty_ = true;
+
+    constexpr bool
+    at_base_end() const {
+      return next_ == std::ranges::end(parent_->base_);
+    }
 
     constexpr bool
     accessible() const noexcept {
-      if (std::ranges::empty(parent_->base()))
+      if (empty_)
         return false;
-      return next_ != std::ranges::end(parent_->base()) or ncount_ != parent_->count();
+      return not at_base_end() or ncount_ != parent_->bound_;
     }
 
   public:
     // using iterator_category = inherited;
     // clang-format off
     using iterator_concept =
+      std::conditional_t<trailing_random_access<Base>,           std::random_access_iterator_tag,
       std::conditional_t<std::ranges::bidirectional_range<Base>, std::bidirectional_iterator_tag,
       std::conditional_t<std::ranges::forward_range<Base>,       std::forward_iterator_tag,
-      /* else */                                                 std::input_iterator_tag>>;
+      /* else */                                                 std::input_iterator_tag>>>;
     // clang-format on
     using difference_type = std::ranges::range_difference_t<Base>;
     using value_type =
@@ -150,13 +171,18 @@ namespace strtpl {
     = default;
     constexpr iterator(Parent& parent, std::ranges::iterator_t<Base> current,
                        std::ranges::range_difference_t<Base> ncount = 0)
-      : parent_(std::addressof(parent)), current_(current),
-        next_([current, b = current == std::ranges::end(parent.base())] {
-          if (b)
-            return current;
-          return std::ranges::next(current);
-        }()),
-        ncount_(ncount) {}
+      : parent_(std::addressof(parent)), current_(std::move(current)), ncount_(ncount),
+        empty_(current_ == std::ranges::end(parent.base_)) {
+      next_ = current_;
+      if (not empty_)
+        ++next_;
+    }
+    // 末尾を指すイテレータ。current_ と next_ は基底の末尾を指す
+    constexpr iterator(Parent& parent, std::default_sentinel_t) requires
+      std::ranges::common_range<Base> and different_from<Bound, std::unreachable_sentinel_t>
+      : parent_(std::addressof(parent)), current_(std::ranges::end(parent.base_)),
+        next_(current_), ncount_(static_cast<difference_type>(parent.bound_)),
+        empty_(std::ranges::empty(parent.base_)) {}
 
     constexpr const std::ranges::iterator_t<Base>&
     base() const& noexcept {
@@ -180,7 +206,7 @@ namespace strtpl {
     constexpr iterator&
     operator++() {
       assert(accessible());
-      if (next_ == std::ranges::end(parent_->base())) {
+      if (at_base_end()) {
         ++ncount_;
       } else {
         current_ = next_;
@@ -208,6 +234,9 @@ namespace strtpl {
         --current_;
       } else {
         --ncount_;
+        // end() で作ったものは current_ も基底の末尾を指すので、最後の要素に戻す
+        if (current_ == next_)
+          --current_;
       }
       return *this;
     }
@@ -218,19 +247,69 @@ namespace strtpl {
       return tmp;
     }
 
+    // 位置は (next_ の位置) - 1 + ncount_ で表される (end() で作ったものも同じ)。
+    // 前進では基底の要素を先に使い切り、後退では ncount_ を先に使い切る
+    constexpr iterator&
+    operator+=(difference_type n) requires trailing_random_access<Base> {
+      if (n > 0) {
+        const auto k =
+          std::min(n, static_cast<difference_type>(std::ranges::end(parent_->base_) - next_));
+        next_ += k;
+        ncount_ += n - k;
+      } else if (n < 0) {
+        const auto k = std::min(-n, ncount_);
+        ncount_ -= k;
+        next_ -= -n - k;
+      }
+      if (n != 0)
+        current_ = next_ - 1;
+      return *this;
+    }
+    constexpr iterator&
+    operator-=(difference_type n) requires trailing_random_access<Base> {
+      return *this += -n;
+    }
+    constexpr std::pair<std::ranges::range_reference_t<Base>, std::ranges::range_difference_t<Base>>
+    operator[](difference_type n) const requires trailing_random_access<Base> {
+      return *(*this + n);
+    }
+
+    friend constexpr iterator
+    operator+(iterator x, difference_type n) requires trailing_random_access<Base> {
+      return x += n;
+    }
+    friend constexpr iterator
+    operator+(difference_type n, iterator x) requires trailing_random_access<Base> {
+      return x += n;
+    }
+    friend constexpr iterator
+    operator-(iterator x, difference_type n) requires trailing_random_access<Base> {
+      return x -= n;
+    }
+    friend constexpr difference_type
+    operator-(const iterator& x, const iterator& y) requires trailing_random_access<Base> {
+      if (x.empty_ and y.empty_)
+        return 0;
+      return static_cast<difference_type>(x.next_ - y.next_) + (x.ncount_ - y.ncount_);
+    }
+
     friend constexpr bool
     operator==(const iterator& x,
                const iterator& y) requires std::equality_comparable<std::ranges::iterator_t<Base>> {
-      if (std::ranges::empty(x.parent_->base()) and std::ranges::empty(y.parent_->base()))
+      if (x.empty_ and y.empty_)
         return true;
       return x.next_ == y.next_ and x.ncount_ == y.ncount_;
     }
     friend constexpr bool
     operator==(const iterator& x, std::default_sentinel_t) requires
       std::equality_comparable<std::ranges::iterator_t<Base>> {
-      if (std::ranges::empty(x.parent_->base()))
+      if (x.empty_)
         return true;
-      return x.next_ == std::ranges::end(x.parent_->base()) and x.ncount_ == x.parent_->count();
+      return x.at_base_end() and x.ncount_ == x.parent_->count();
+    }
+    friend constexpr auto
+    operator<=>(const iterator& x, const iterator& y) requires trailing_random_access<Base> {
+      return (x - y) <=> 0;
     }
 
     friend constexpr std::pair<std::ranges::range_rvalue_reference_t<Base>,
@@ -239,7 +318,5 @@ namespace strtpl {
       assert(x.accessible());
       return {std::ranges::iter_move(x.current_), x.ncount_};
     }
-
-    // TODO: methods for random_access_iterator
   };
 } // namespace strtpl
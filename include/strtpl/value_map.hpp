@@ -0,0 +1,270 @@
+/// @file value_map.hpp
+#pragma once
+#include <algorithm>   // std::ranges::stable_sort, std::ranges::unique
+#include <cstddef>     // std::ptrdiff_t, std::size_t
+#include <cstdint>     // std::uint32_t, std::uint64_t
+#include <functional>  // std::hash, std::equal_to, std::less
+#include <initializer_list>
+#include <map>
+#include <memory>      // std::addressof
+#include <ranges>      // std::ranges::input_range
+#include <string>
+#include <string_view>
+#include <type_traits> // std::make_unsigned_t
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <strtpl/fwd.hpp>
+
+namespace strtpl {
+
+  // basic_value_map
+  // placeholder の値を引くための読み取り専用の map。
+  // key と値の文字は一つの連続した領域に置き、key の全ての文字から作った 64 bit の tag (FNV-1a)
+  // だけを並べた配列と、(key, 値) の string_view の組の配列を別に持つ。
+  // 探索は tag の配列を走査 (key が多ければ tag による開番地法の索引を引く) して候補を絞り込み、
+  // tag が一致した key だけを比較する。key が重複するときは最初のものを使う。
+  // 既定の引数と別名 (value_map など) は fwd.hpp で宣言する
+
+  template <class CharT, class ST>
+  class basic_value_map {
+  public:
+    using key_type = std::basic_string_view<CharT, ST>;
+    using mapped_type = std::basic_string_view<CharT, ST>;
+    using value_type = std::pair<key_type, mapped_type>;
+    using size_type = std::size_t;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+    using iterator = const_iterator;
+
+  private:
+    // この数以下ならば tag の配列を線形に走査する
+    static constexpr size_type linear_max = 8;
+
+    std::vector<CharT> chars_{};
+    std::vector<std::uint64_t> tags_{};
+    std::vector<value_type> entries_{};
+    // 要素数の 2 倍以上の 2 の冪の大きさの索引。値は entries_ の添字 + 1 (0 は空)
+    std::vector<std::uint32_t> slots_{};
+    int shift_ = 64;
+
+    constexpr size_type
+    slot(std::uint64_t t) const noexcept {
+      return static_cast<size_type>((t * 0x9e3779b97f4a7c15u) >> shift_);
+    }
+
+    // key の各文字を下位のバイトから順に混ぜる FNV-1a。"key10", "key20" のように長さと両端の
+    // 文字が同じ key の集合でも tag が分かれる
+    static constexpr std::uint64_t
+    tag(key_type k) noexcept {
+      using unsigned_char_type = std::make_unsigned_t<CharT>;
+      std::uint64_t h = 0xcbf29ce484222325u;
+      for (const CharT c : k) {
+        std::uint32_t u = static_cast<unsigned_char_type>(c);
+        for (size_type i = 0; i < sizeof(CharT); ++i, u >>= 8) {
+          h ^= u & 0xffu;
+          h *= 0x100000001b3u;
+        }
+      }
+      return h;
+    }
+
+    void
+    build(std::vector<value_type> pairs) {
+      std::ranges::stable_sort(pairs, [](const value_type& x, const value_type& y) {
+        const auto tx = tag(x.first), ty = tag(y.first);
+        return tx != ty ? tx < ty : x.first < y.first;
+      });
+      const auto [first, last] = std::ranges::unique(
+        pairs, [](const value_type& x, const value_type& y) { return x.first == y.first; });
+      pairs.erase(first, last);
+
+      size_type n = 0;
+      for (const auto& [k, v] : pairs)
+        n += k.size() + v.size();
+      chars_.reserve(n);
+      for (const auto& [k, v] : pairs) {
+        chars_.insert(chars_.end(), k.begin(), k.end());
+        chars_.insert(chars_.end(), v.begin(), v.end());
+      }
+      entries_.reserve(pairs.size());
+      tags_.reserve(pairs.size());
+      const CharT* p = chars_.data();
+      for (const auto& [k, v] : pairs) {
+        entries_.emplace_back(key_type(p, k.size()), mapped_type(p + k.size(), v.size()));
+        tags_.push_back(tag(k));
+        p += k.size() + v.size();
+      }
+
+      if (entries_.size() <= linear_max)
+        return;
+      int bits = 1;
+      while ((size_type{1} << bits) < 2 * entries_.size())
+        ++bits;
+      shift_ = 64 - bits;
+      slots_.assign(size_type{1} << bits, 0);
+      const size_type mask = slots_.size() - 1;
+      for (size_type i = 0; i < entries_.size(); ++i) {
+        auto j = slot(tags_[i]);
+        while (slots_[j] != 0)
+          j = (j + 1) & mask;
+        slots_[j] = static_cast<std::uint32_t>(i + 1);
+      }
+    }
+
+    // 複製した chars_ を指すように entries_ を付け替える
+    void
+    rebase(const basic_value_map& other) {
+      const CharT* const base = other.chars_.data();
+      for (auto& [k, v] : entries_) {
+        k = key_type(chars_.data() + (k.data() - base), k.size());
+        v = mapped_type(chars_.data() + (v.data() - base), v.size());
+      }
+    }
+
+  public:
+    basic_value_map() = default;
+    basic_value_map(std::initializer_list<value_type> il)
+      : basic_value_map(std::views::all(il)) {}
+    // clang-format off
+    template <std::ranges::input_range Range>
+    requires requires(std::ranges::range_reference_t<Range> x) {
+      key_type(get<0>(x));
+      mapped_type(get<1>(x));
+    }
+    // clang-format on
+    explicit basic_value_map(Range&& r) {
+      std::vector<value_type> pairs;
+      for (auto&& x : r)
+        pairs.emplace_back(key_type(get<0>(x)), mapped_type(get<1>(x)));
+      build(std::move(pairs));
+    }
+
+    basic_value_map(const basic_value_map& other)
+      : chars_(other.chars_), tags_(other.tags_), entries_(other.entries_),
+        slots_(other.slots_), shift_(other.shift_) {
+      rebase(other);
+    }
+    basic_value_map&
+    operator=(const basic_value_map& other) {
+      if (this != std::addressof(other)) {
+        chars_ = other.chars_;
+        tags_ = other.tags_;
+        entries_ = other.entries_;
+        slots_ = other.slots_;
+        shift_ = other.shift_;
+        rebase(other);
+      }
+      return *this;
+    }
+    // std::vector の移動は領域を引き継ぐため、string_view は無効にならない
+    basic_value_map(basic_value_map&&) noexcept = default;
+    basic_value_map&
+    operator=(basic_value_map&&) noexcept = default;
+
+    size_type
+    size() const noexcept {
+      return entries_.size();
+    }
+    bool
+    empty() const noexcept {
+      return entries_.empty();
+    }
+    const_iterator
+    begin() const noexcept {
+      return entries_.begin();
+    }
+    const_iterator
+    end() const noexcept {
+      return entries_.end();
+    }
+
+    const_iterator
+    find(key_type key) const noexcept {
+      const std::uint64_t t = tag(key);
+      const auto equal = [&](size_type i) {
+        return tags_[i] == t and entries_[i].first.size() == key.size()
+               and ST::compare(entries_[i].first.data(), key.data(), key.size()) == 0;
+      };
+      if (slots_.empty()) {
+        for (size_type i = 0; i < tags_.size(); ++i)
+          if (equal(i))
+            return begin() + static_cast<std::ptrdiff_t>(i);
+        return end();
+      }
+      const size_type mask = slots_.size() - 1;
+      for (auto j = slot(t); slots_[j] != 0; j = (j + 1) & mask)
+        if (const size_type i = slots_[j] - 1; equal(i))
+          return begin() + static_cast<std::ptrdiff_t>(i);
+      return end();
+    }
+    bool
+    contains(key_type key) const noexcept {
+      return find(key) != end();
+    }
+  }; // class basic_value_map
+
+  // basic_transparent_hash
+  // std::basic_string を key とする非順序連想コンテナを basic_string_view で一時オブジェクト無しに
+  // 探索するための hash。std::equal_to<> と組み合わせる
+
+  template <class CharT, class ST = std::char_traits<CharT>>
+  struct basic_transparent_hash {
+    using is_transparent = void;
+
+    std::size_t
+    operator()(std::basic_string_view<CharT, ST> s) const noexcept {
+      return std::hash<std::basic_string_view<CharT, ST>>{}(s);
+    }
+  };
+
+  // unordered_string_map, string_map
+  // basic_string_view による探索 (heterogeneous lookup) に対応した標準のコンテナ
+
+  template <class T, class CharT = char, class ST = std::char_traits<CharT>,
+            class Allocator = std::allocator<std::pair<const std::basic_string<CharT, ST>, T>>>
+  using unordered_string_map = std::unordered_map<std::basic_string<CharT, ST>, T,
+                                                  basic_transparent_hash<CharT, ST>,
+                                                  std::equal_to<>, Allocator>;
+
+  template <class T, class CharT = char, class ST = std::char_traits<CharT>,
+            class Allocator = std::allocator<std::pair<const std::basic_string<CharT, ST>, T>>>
+  using string_map = std::map<std::basic_string<CharT, ST>, T, std::less<>, Allocator>;
+
+  // transparent_map_ref
+  // key_type を basic_string_view から明示的に構築できる map (std::unordered_map<std::string, ...>
+  // など) を map_with_key_type を満たすように包む。map が basic_string_view で探索できるならば
+  // そのまま、できなければ一時的な key_type を作って探索する
+
+  template <class Map>
+  class transparent_map_ref {
+  private:
+    const Map* map_;
+
+  public:
+    explicit transparent_map_ref(const Map& map) noexcept : map_(std::addressof(map)) {}
+
+    auto
+    begin() const {
+      return map_->begin();
+    }
+    auto
+    end() const {
+      return map_->end();
+    }
+
+    template <class Key>
+    auto
+    find(const Key& key) const {
+      if constexpr (requires { map_->find(key); })
+        return map_->find(key);
+      else
+        return map_->find(typename Map::key_type(key));
+    }
+  }; // class transparent_map_ref
+
+  template <class Map>
+  transparent_map_ref<Map>
+  transparent(const Map& map) noexcept {
+    return transparent_map_ref<Map>(map);
+  }
+} // namespace strtpl
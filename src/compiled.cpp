@@ -0,0 +1,58 @@
+#include <strtpl/compiled.hpp>
+
+namespace strtpl {
+
+  template struct basic_string_template<char>;
+  template struct basic_string_template<wchar_t>;
+  template class basic_value_map<char>;
+  template class basic_value_map<wchar_t>;
+  template class basic_template_view<char>;
+  template class basic_template_view<wchar_t>;
+  template class basic_parsed_template<char>;
+  template class basic_parsed_template<wchar_t>;
+
+  template std::string
+  string_template::operator()(std::string_view, const compiled_string_map<char>&) const;
+  template std::string
+  string_template::operator()(std::string_view, const value_map&) const;
+  template std::wstring
+  wstring_template::operator()(std::wstring_view, const compiled_string_map<wchar_t>&) const;
+  template std::wstring
+  wstring_template::operator()(std::wstring_view, const wvalue_map&) const;
+
+  template parsed_template
+  parse(const string_template&, std::string_view);
+  template wparsed_template
+  parse(const wstring_template&, std::wstring_view);
+
+  template std::string
+  template_view::operator()(const compiled_string_map<char>&, escape) const;
+  template std::string
+  template_view::operator()(const value_map&, escape) const;
+  template std::wstring
+  wtemplate_view::operator()(const compiled_string_map<wchar_t>&, escape) const;
+  template std::wstring
+  wtemplate_view::operator()(const wvalue_map&, escape) const;
+
+  namespace compiled {
+
+    std::string
+    substitute(std::string_view s,
+               const std::unordered_map<std::string_view, std::string_view>& map) {
+      return strtpl::substitute(s, map);
+    }
+    std::string
+    substitute(std::string_view s, const value_map& map) {
+      return strtpl::substitute(s, map);
+    }
+    std::wstring
+    substitute(std::wstring_view s,
+               const std::unordered_map<std::wstring_view, std::wstring_view>& map) {
+      return strtpl::wsubstitute(s, map);
+    }
+    std::wstring
+    substitute(std::wstring_view s, const wvalue_map& map) {
+      return strtpl::wsubstitute(s, map);
+    }
+  } // namespace compiled
+} // namespace strtpl
@@ -0,0 +1,109 @@
+#include <catch2/catch_test_macros.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <strtpl/bounded.hpp>
+#include <strtpl/string_template.hpp>
+
+namespace {
+  // 上限を超えたときの例外を返す (超えなければ何も返さない)
+  template <class Fn>
+  std::optional<strtpl::limit_exceeded>
+  exceeded(Fn fn) {
+    try {
+      fn();
+    } catch (const strtpl::limit_exceeded& e) {
+      return e;
+    }
+    return std::nullopt;
+  }
+} // namespace
+
+TEST_CASE("render_bounded", "[bounded]") {
+  const std::unordered_map<std::string_view, std::string_view> map{
+    {"who", "Alice"}, {"what", "banana"}, {"x", ""}};
+  { // 上限の内側では substitute と等しい
+    for (std::string_view s : {"", "plain text", "$who likes ${what}.", "$$who ${who}s $x$x$$",
+                               "$who$who$who", "a\nb $what\r\nc"})
+      CHECK(strtpl::render_bounded(strtpl::substitute, s, map) == strtpl::substitute(s, map));
+    const std::unordered_map<std::wstring_view, std::wstring_view> wmap{{L"who", L"Alice"}};
+    CHECK(strtpl::render_bounded(strtpl::wsubstitute, std::wstring_view(L"$who $$ ${who}"), wmap)
+          == L"Alice $ Alice");
+    // key が見つからない場合と不正な placeholder は substitute と同じ例外
+    CHECK_THROWS_AS(strtpl::render_bounded(strtpl::substitute, std::string_view("$nobody"), map),
+                    std::out_of_range);
+    std::string msg;
+    try {
+      strtpl::render_bounded(strtpl::substitute, std::string_view("a\n $"), map);
+    } catch (const std::runtime_error& e) {
+      msg = e.what();
+    }
+    CHECK(msg == "Invalid placeholder in string: line 2, col 2");
+  }
+  { // 値は書式として解釈しない (substitute は match_results::format を通す)
+    const std::unordered_map<std::string_view, std::string_view> prices{{"price", "$&!"}};
+    const std::string_view s = "[${price}]";
+    CHECK(strtpl::render_bounded(strtpl::substitute, s, prices) == "[$&!]");
+    CHECK(strtpl::substitute(s, prices) == "[${price}!]");
+  }
+  { // 入力、出力、placeholder の数
+    const std::string_view s = "$who likes $what.";
+    strtpl::render_limits limits;
+    limits.max_input = 16;
+    auto err = exceeded([&] { strtpl::render_bounded(strtpl::substitute, s, map, limits); });
+    REQUIRE(err.has_value());
+    CHECK(err->which() == strtpl::render_limit::input);
+
+    limits = {};
+    limits.max_output = 14;
+    err = exceeded([&] { strtpl::render_bounded(strtpl::substitute, s, map, limits); });
+    REQUIRE(err.has_value());
+    CHECK(err->which() == strtpl::render_limit::output);
+    CHECK(err->offset() == 11);
+    CHECK(std::string_view(err->what()) == "Error: output limit exceeded: offset 11");
+    limits.max_output = 19;
+    CHECK(strtpl::render_bounded(strtpl::substitute, s, map, limits) == "Alice likes banana.");
+
+    limits = {};
+    limits.max_placeholders = 1;
+    err = exceeded([&] { strtpl::render_bounded(strtpl::substitute, s, map, limits); });
+    REQUIRE(err.has_value());
+    CHECK(err->which() == strtpl::render_limit::placeholders);
+    CHECK(err->offset() == 11);
+  }
+  { // 正規表現の入れ子
+    const strtpl::string_template nested{"$", "(?:(?:(?:(?:([a-z]+)))))"};
+    strtpl::render_limits limits;
+    limits.max_nesting = 4;
+    const auto err = exceeded(
+      [&] { strtpl::render_bounded(nested, std::string_view("$who"), map, limits); });
+    REQUIRE(err.has_value());
+    CHECK(err->which() == strtpl::render_limit::nesting);
+    limits.max_nesting = 6;
+    CHECK(strtpl::render_bounded(nested, std::string_view("$who"), map, limits) == "Alice");
+  }
+  { // 照合の手間: 優先度の高い選択肢 x[^Q]*Q は Q を探して入力の末尾まで走査してから x に一致する
+    // ため、$x が続くと全体で入力の長さの二乗の手間がかかる
+    const strtpl::string_template greedy{"$", "(x[^Q]*Q|x)"};
+    const std::unordered_map<std::string_view, std::string_view> xmap{{"x", "1"}};
+    std::string s;
+    for (int i = 0; i < 2000; ++i)
+      s += "$x";
+    CHECK(strtpl::render_bounded(greedy, std::string_view(s).substr(0, 20), xmap) == "1111111111");
+    strtpl::render_limits limits;
+    limits.max_steps = 100000;
+    const auto err = exceeded(
+      [&] { strtpl::render_bounded(greedy, std::string_view(s), xmap, limits); });
+    REQUIRE(err.has_value());
+    CHECK(err->which() == strtpl::render_limit::steps);
+    CHECK(err->offset() < s.size());
+  }
+  { // std::regex ではスタックを使い果たす長い識別子
+    const std::string id(1 << 16, 'a');
+    const std::unordered_map<std::string_view, std::string_view> long_map{{id, "v"}};
+    const std::string s = "<$" + id + ">";
+    CHECK(strtpl::render_bounded(strtpl::substitute, std::string_view(s), long_map) == "<v>");
+  }
+}
@@ -0,0 +1,30 @@
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <strtpl/compiled.hpp>
+
+TEST_CASE("compiled", "[compiled]") {
+  const strtpl::compiled_string_map<char> map{{"who", "Alice"}, {"what", "banana"}};
+  const strtpl::value_map vmap{{"who", "Bob"}, {"what", "apple"}};
+  { // 明示的に実体化したもの
+    CHECK(strtpl::substitute(std::string_view("$who likes ${what}."), map)
+          == "Alice likes banana.");
+    CHECK(strtpl::substitute(std::string_view("$who likes ${what}."), vmap) == "Bob likes apple.");
+    const auto t = strtpl::parse(strtpl::substitute, std::string_view("$who: $what"));
+    CHECK(t.view()(map) == "Alice: banana");
+    CHECK(t.view()(vmap) == "Bob: apple");
+    CHECK_THROWS_AS(strtpl::substitute(std::string_view("$"), map), std::runtime_error);
+  }
+  { // wchar_t
+    const strtpl::compiled_string_map<wchar_t> wmap{{L"who", L"Alice"}};
+    const strtpl::wvalue_map wvmap{{L"who", L"Bob"}};
+    CHECK(strtpl::wsubstitute(std::wstring_view(L"Hi, $who"), wmap) == L"Hi, Alice");
+    CHECK(strtpl::wsubstitute(std::wstring_view(L"Hi, $who"), wvmap) == L"Hi, Bob");
+    CHECK(strtpl::parse(strtpl::wsubstitute, std::wstring_view(L"$who"))(wvmap) == L"Bob");
+  }
+  { // fwd.hpp の関数
+    CHECK(strtpl::compiled::substitute(std::string_view("$who"), vmap) == "Bob");
+  }
+}
@@ -0,0 +1,20 @@
+// <regex> を読み込まずに置換する翻訳単位
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <strtpl/fwd.hpp>
+
+#ifdef _GLIBCXX_REGEX
+#error "fwd.hpp must not include <regex>"
+#endif
+
+TEST_CASE("fwd", "[compiled]") {
+  const std::unordered_map<std::string_view, std::string_view> map{{"who", "Alice"}};
+  CHECK(strtpl::compiled::substitute(std::string_view("Hi, $who! $$"), map) == "Hi, Alice! $");
+  const std::unordered_map<std::wstring_view, std::wstring_view> wmap{{L"who", L"Alice"}};
+  CHECK(strtpl::compiled::substitute(std::wstring_view(L"Hi, ${who}!"), wmap) == L"Hi, Alice!");
+  CHECK_THROWS_AS(strtpl::compiled::substitute(std::string_view("$nobody"), map),
+                  std::out_of_range);
+}
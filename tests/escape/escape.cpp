@@ -0,0 +1,96 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cctype> // std::isalnum
+#include <cstdio> // std::snprintf
+#include <string>
+#include <string_view>
+#include <strtpl/escape.hpp>
+
+namespace {
+  // 一文字ずつエスケープする参照実装
+  std::string
+  reference(strtpl::escape e, std::string_view s) {
+    std::string r;
+    for (const char ch : s) {
+      const auto c = static_cast<unsigned char>(ch);
+      char buf[8];
+      switch (e) {
+      case strtpl::escape::html:
+        if (c == '&') r += "&amp;";
+        else if (c == '<') r += "&lt;";
+        else if (c == '>') r += "&gt;";
+        else if (c == '"') r += "&quot;";
+        else if (c == '\'') r += "&#39;";
+        else r += ch;
+        break;
+      case strtpl::escape::json:
+        if (c == '"') r += "\\\"";
+        else if (c == '\\') r += "\\\\";
+        else if (c == '\n') r += "\\n";
+        else if (c == '\r') r += "\\r";
+        else if (c == '\t') r += "\\t";
+        else if (c == '\b') r += "\\b";
+        else if (c == '\f') r += "\\f";
+        else if (c < 0x20) {
+          std::snprintf(buf, sizeof(buf), "\\u%04X", c);
+          r += buf;
+        } else r += ch;
+        break;
+      case strtpl::escape::url:
+        if (std::isalnum(c) or c == '-' or c == '.' or c == '_' or c == '~') r += ch;
+        else {
+          std::snprintf(buf, sizeof(buf), "%%%02X", c);
+          r += buf;
+        }
+        break;
+      case strtpl::escape::shell:
+        if (c == '\'') r += "'\\''";
+        else r += ch;
+        break;
+      default: r += ch;
+      }
+    }
+    return e == strtpl::escape::shell ? "'" + r + "'" : r;
+  }
+} // namespace
+
+TEST_CASE("escape", "[escape]") {
+  using strtpl::escape;
+  { // 短い文字列
+    const std::string_view s = R"(<a href="x?a=1&b='2'">)";
+    CHECK(strtpl::escaped(escape::html, s)
+          == "&lt;a href=&quot;x?a=1&amp;b=&#39;2&#39;&quot;&gt;");
+    CHECK(strtpl::escaped(escape::json, std::string_view("a\"b\\c\n\x01"))
+          == "a\\\"b\\\\c\\n\\u0001");
+    CHECK(strtpl::escaped(escape::url, std::string_view("a b/c~")) == "a%20b%2Fc~");
+    CHECK(strtpl::escaped(escape::shell, std::string_view("it's")) == "'it'\\''s'");
+    CHECK(strtpl::escaped(escape::shell, std::string_view()) == "''");
+    CHECK(strtpl::escaped(escape::none, std::string_view("<&>")) == "<&>");
+  }
+  { // SIMD で処理する長さを含め、全てのバイトについて参照実装と一致する
+    std::string s;
+    for (int i = 0; i < 4; ++i)
+      for (int c = 0; c < 256; ++c)
+        s += static_cast<char>(c);
+    s += std::string(100, 'x') + "&" + std::string(37, 'y');
+    for (const auto kind : {escape::none, escape::html, escape::json, escape::url, escape::shell}) {
+      for (std::size_t n : {std::size_t{0}, std::size_t{15}, std::size_t{16}, std::size_t{17},
+                            std::size_t{300}, s.size()}) {
+        const auto sub = std::string_view(s).substr(0, n);
+        const auto expected = reference(kind, sub);
+        CHECK(strtpl::escaped_size(kind, sub) == expected.size());
+        CHECK(strtpl::escaped(kind, sub) == expected);
+      }
+    }
+  }
+  { // wchar_t
+    CHECK(strtpl::escaped(escape::html, std::wstring_view(L"<あ>")) == L"&lt;あ&gt;");
+    CHECK(strtpl::escaped(escape::json, std::wstring_view(L"あ\n")) == L"あ\\n");
+    CHECK(not strtpl::escape_supported<wchar_t>(escape::url));
+    CHECK(strtpl::escape_supported<char8_t>(escape::url));
+  }
+  { // escape_from_name
+    CHECK(strtpl::escape_from_name("html") == escape::html);
+    CHECK(strtpl::escape_from_name("raw") == escape::none);
+    CHECK(not strtpl::escape_from_name("xml").has_value());
+  }
+}
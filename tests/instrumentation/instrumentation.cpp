@@ -0,0 +1,83 @@
+#include <catch2/catch_test_macros.hpp>
+#include <regex>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <strtpl/instrumentation.hpp>
+#include <strtpl/regex.hpp>
+#include <strtpl/string_template.hpp>
+
+namespace instr = strtpl::instrumentation;
+
+namespace {
+  // 呼び出しの前後の差分
+  template <class Fn>
+  instr::render_stats
+  measure(Fn fn) {
+    const auto before = instr::thread_snapshot();
+    fn();
+    const auto after = instr::thread_snapshot();
+    instr::render_stats r;
+    for (auto m : instr::members)
+      r.*m = after.*m - before.*m;
+    return r;
+  }
+} // namespace
+
+TEST_CASE("instrumentation", "[instrumentation]") {
+  static_assert(STRTPL_INSTRUMENTATION == 1);
+  static_assert(std::is_same_v<strtpl::string_template, strtpl::_instrumented::string_template>);
+  const std::unordered_map<std::string_view, std::string_view> map{
+    {"who", "Alice"},
+    {"what", "banana"},
+  };
+  { // substitute
+    std::string r;
+    const auto d = measure([&] { r = strtpl::substitute("$who likes ${what} ($$)", map); });
+    CHECK(r == "Alice likes banana ($)");
+    CHECK(d.renders == 1);
+    CHECK(d.replacements == 1);
+    CHECK(d.matches == 3);
+    CHECK(d.placeholders == 2);
+    CHECK(d.input_bytes == 23);
+    CHECK(d.output_bytes == r.size());
+    CHECK(d.output_reallocations >= 1);
+    CHECK(d.missing_keys == 0);
+    CHECK(d.invalid_placeholders == 0);
+  }
+  { // missing key
+    const auto d = measure([&] { CHECK_THROWS(strtpl::substitute("$who likes $where", map)); });
+    CHECK(d.renders == 1);
+    CHECK(d.placeholders == 1);
+    CHECK(d.missing_keys == 1);
+  }
+  { // invalid placeholder
+    const auto d = measure([&] { CHECK_THROWS(strtpl::substitute("$who likes $.", map)); });
+    CHECK(d.invalid_placeholders == 1);
+  }
+  { // regex::regex_replace_fn
+    const std::regex re{R"(\d+)"};
+    constexpr auto fn = [](auto&&) -> std::string_view { return "N"; };
+    const auto d = measure([&] {
+      CHECK(strtpl::regex::regex_replace_fn(std::string_view("a1b22c333"), re, fn) == "aNbNcN");
+    });
+    CHECK(d.renders == 0);
+    CHECK(d.replacements == 1);
+    CHECK(d.matches == 3);
+    CHECK(d.input_bytes == 9);
+    CHECK(d.output_bytes == 6);
+  }
+  { // 終了したスレッドの値も合計に含まれる
+    const auto before = instr::snapshot();
+    std::thread t([&] {
+      for (int i = 0; i < 10; ++i)
+        strtpl::substitute("$who", map);
+    });
+    t.join();
+    const auto after = instr::snapshot();
+    CHECK(after.renders - before.renders == 10);
+    CHECK(after.placeholders - before.placeholders == 10);
+    CHECK(not instr::thread_snapshots().empty());
+  }
+}
@@ -0,0 +1,24 @@
+// 計測しない翻訳単位。同じプログラムの計測する翻訳単位 (instrumentation.cpp) と同じ特殊化を使っても、
+// 計測しない定義が選ばれる
+#undef STRTPL_INSTRUMENTATION
+#define STRTPL_INSTRUMENTATION 0
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <strtpl/instrumentation.hpp>
+#include <strtpl/string_template.hpp>
+
+static_assert(std::is_same_v<strtpl::string_template, strtpl::_plain::string_template>);
+
+TEST_CASE("plain", "[instrumentation]") {
+  namespace instr = strtpl::instrumentation;
+  const std::unordered_map<std::string_view, std::string_view> map{
+    {"who", "Alice"},
+    {"what", "banana"},
+  };
+  const auto before = instr::thread_snapshot();
+  CHECK(strtpl::substitute("$who likes ${what} ($$)", map) == "Alice likes banana ($)");
+  CHECK(instr::thread_snapshot() == before);
+}
@@ -0,0 +1,92 @@
+#include <catch2/catch_test_macros.hpp>
+#include <iterator>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <strtpl/literal_replacer.hpp>
+
+TEST_CASE("literal_replacer", "[literal_replacer]") {
+  { // no needles
+    strtpl::literal_replacer rep;
+    CHECK(rep.empty());
+    CHECK(rep("abc") == "abc");
+  }
+  { // single needle
+    strtpl::literal_replacer rep{{"%%FOO%%", "foo"}};
+    CHECK(rep.size() == 1);
+    CHECK(rep("a%%FOO%%b%%FOO%%") == "afoobfoo");
+    CHECK(rep("%%FOO%") == "%%FOO%");
+    CHECK(rep("") == "");
+  }
+  { // multiple needles
+    strtpl::literal_replacer rep{
+      {"%%FOO%%", "foo"},
+      {"%%BAR%%", "bar"},
+      {"%%BAZ%%", ""},
+    };
+    CHECK(rep("[%%FOO%%|%%BAR%%|%%BAZ%%]") == "[foo|bar|]");
+    CHECK(rep("%%%FOO%%%") == "%foo%");
+  }
+  { // leftmost
+    strtpl::literal_replacer rep{{"bc", "X"}, {"abcd", "Y"}};
+    CHECK(rep("abcd") == "Y");
+    CHECK(rep("abce") == "aXe");
+  }
+  { // longest
+    strtpl::literal_replacer rep{{"ab", "X"}, {"abcdx", "Y"}, {"cd", "Z"}};
+    CHECK(rep("abcdx") == "Y");
+    CHECK(rep("abcdy") == "XZy");
+    CHECK(rep("abcd") == "XZ");
+  }
+  { // overlapping occurrences are not replaced twice
+    strtpl::literal_replacer rep{{"aa", "b"}};
+    CHECK(rep("aaaaa") == "bba");
+  }
+  { // duplicated needles prefer the first
+    strtpl::literal_replacer rep{{"a", "1"}, {"a", "2"}};
+    CHECK(rep.size() == 1);
+    CHECK(rep("aa") == "11");
+  }
+  { // construct from range
+    std::map<std::string, std::string> m{{"he", "HE"}, {"she", "SHE"}, {"hers", "HERS"}};
+    strtpl::literal_replacer rep(m);
+    CHECK(rep("ushers") == "uSHErs");
+    CHECK(rep("hershe") == "HERSHE");
+  }
+  { // output iterator
+    strtpl::literal_replacer rep{{"x", "yz"}};
+    std::vector<char> v;
+    std::string_view s = "axbx";
+    strtpl::literal_replace(std::back_inserter(v), s, rep);
+    CHECK(std::string_view(v.data(), v.size()) == "ayzbyz");
+    CHECK(strtpl::literal_replace(s, rep) == "ayzbyz");
+  }
+  { // 区間の境界をまたぐ一致と、最長の needle が区間より長い場合
+    for (std::size_t len : {3u, 1500u}) {
+      // "a" * (len - 1) + "b" は "a" * k + "b" のうち k >= len - 1 のものの末尾に一致する
+      strtpl::literal_replacer rep{{"a", "1"}, {std::string(len - 1, 'a') + 'b', "L"}, {"ab", "2"}};
+      const auto expected = [len](std::size_t k) {
+        if (k == 0)
+          return std::string("b");
+        if (k < len - 1)
+          return std::string(k - 1, '1') + "2";
+        return std::string(k - (len - 1), '1') + "L";
+      };
+      std::string s, r;
+      for (std::size_t i = 0; i < 3000; ++i) {
+        s += std::string(i % (len + 2), 'a') + 'b';
+        r += expected(i % (len + 2));
+      }
+      CHECK(rep(s) == r);
+    }
+  }
+  { // empty needle
+    CHECK_THROWS_AS(strtpl::literal_replacer({{"", "x"}}), std::invalid_argument);
+  }
+}
+
+TEST_CASE("wliteral_replacer", "[literal_replacer]") {
+  strtpl::wliteral_replacer rep{{L"あい", L"ai"}, {L"%", L"%%"}};
+  CHECK(rep(L"ああい%") == L"あai%%");
+}
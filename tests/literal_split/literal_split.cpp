@@ -0,0 +1,93 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <ranges>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <strtpl/literal_split.hpp>
+#include <strtpl/regex.hpp>
+
+namespace test {
+  template <class Range>
+  std::vector<std::string>
+  to_vector(Range&& r) {
+    std::vector<std::string> v;
+    for (auto&& x : r)
+      v.emplace_back(std::ranges::begin(x), std::ranges::end(x));
+    return v;
+  }
+} // namespace test
+
+TEST_CASE("literal_split", "[literal_split]") {
+  { // static_assert
+    using View = strtpl::basic_literal_split_view<char>;
+    static_assert(std::ranges::view<View>);
+    static_assert(std::ranges::forward_range<View>);
+    static_assert(std::ranges::common_range<View>);
+    // size() は最初の呼び出しで数を保持するので、非 const の view だけが sized_range
+    static_assert(std::ranges::sized_range<View>);
+    static_assert(not std::ranges::sized_range<const View>);
+    static_assert(std::same_as<std::ranges::range_value_t<View>, std::string_view>);
+  }
+  { // single character
+    std::string_view s = "a,b,,c";
+    auto r = strtpl::literal_split(s, ',');
+    CHECK(r.count() == 4);
+    CHECK(test::to_vector(r) == std::vector<std::string>{"a", "b", "", "c"});
+    CHECK(test::to_vector(strtpl::literal_split(s, ',', true))
+          == std::vector<std::string>{"a,", "b,", ",", "c"});
+  }
+  { // string
+    std::string_view s = "a\r\nb\r\n";
+    auto r = strtpl::literal_split(s, std::string_view("\r\n"));
+    CHECK(r.count() == 3);
+    CHECK(test::to_vector(r) == std::vector<std::string>{"a", "b", ""});
+  }
+  { // no delimiter
+    std::string_view s = "abc";
+    auto r = strtpl::literal_split(s, ',');
+    CHECK(r.empty());
+    CHECK(r.count() == 0);
+  }
+  { // long input
+    std::string s;
+    for (int i = 0; i < 100; ++i)
+      s += std::to_string(i) + ";";
+    auto r = strtpl::literal_split(std::string_view(s), ';');
+    CHECK(r.count() == 101);
+    CHECK(std::ranges::distance(r) == 101);
+    CHECK(r.size() == 101);
+    CHECK(std::ranges::size(r) == 101);
+    const auto copy = r;
+    CHECK(copy.count() == 101);
+    auto empty = strtpl::literal_split(std::string_view("abc"), std::string_view("::"));
+    CHECK(empty.size() == 0);
+    CHECK(empty.size() == 0);
+  }
+  { // empty delimiter
+    CHECK_THROWS_AS(strtpl::literal_split(std::string_view("a\0b"), std::string_view()),
+                    std::invalid_argument);
+  }
+}
+
+TEST_CASE("literal_split generators", "[literal_split][generators]") {
+  const auto s = GENERATE(std::string_view(""), std::string_view("x"), std::string_view("--"),
+                          std::string_view("a--b-c--"), std::string_view("---a----b"));
+  const auto keepend = GENERATE(false, true);
+  { // same as regex_split
+    const std::regex re{"--"};
+    auto expected = test::to_vector(strtpl::regex::v2::regex_split(s, re, keepend));
+    auto r = strtpl::literal_split(s, std::string_view("--"), keepend);
+    CHECK(test::to_vector(r) == expected);
+    CHECK(r.count() == expected.size());
+  }
+  {
+    const std::regex re{"-"};
+    auto expected = test::to_vector(strtpl::regex::v2::regex_split(s, re, keepend));
+    auto r = strtpl::literal_split(s, '-', keepend);
+    CHECK(test::to_vector(r) == expected);
+    CHECK(r.count() == expected.size());
+  }
+}
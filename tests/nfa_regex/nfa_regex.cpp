@@ -0,0 +1,156 @@
+#include <catch2/catch_test_macros.hpp>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <strtpl/nfa_regex.hpp>
+#include <strtpl/regex.hpp>
+#include <strtpl/string_template.hpp>
+
+namespace test {
+  // 全ての一致を "位置:長さ" の列として書き出す
+  template <class Re>
+  std::string
+  matches(std::string_view s, const Re& re) {
+    std::string r;
+    for (const auto& mr : strtpl::regex::regex_range(s, re)) {
+      for (std::size_t i = 0; i < mr.size(); ++i)
+        r += mr[i].matched ? std::to_string(mr.position(i)) + ":" + std::to_string(mr.length(i))
+                           : std::string("-");
+      r += ";";
+    }
+    return r;
+  }
+} // namespace test
+
+TEST_CASE("nfa_regex", "[nfa_regex]") {
+  { // static_assert
+    using It = std::string_view::iterator;
+    static_assert(strtpl::regex_engine<strtpl::nfa_regex, It>);
+    static_assert(not strtpl::regex_engine<std::regex, It>);
+    static_assert(std::forward_iterator<strtpl::engine_iterator<It, strtpl::nfa_regex>>);
+  }
+  { // same matches as std::regex
+    const std::vector<std::string_view> patterns{
+      R"(\d+)",
+      R"([a-c]+|x)",
+      R"(a*)",
+      R"((a)|(b)|c)",
+      R"((?:ab)+?)",
+      R"(a?b??)",
+      R"([^\s\d]+)",
+      R"(\$(?:([_a-zA-Z][_a-zA-Z0-9]*)|\{([_a-zA-Z][_a-zA-Z0-9]*)\}|(\$)|()))",
+      R"(^a|c$)",
+      R"(.\.)",
+      R"([\w-]+)",
+      R"((a|ab)(c|bcd)(d*))",
+    };
+    const std::vector<std::string_view> inputs{
+      "",
+      "abc123def45",
+      "aaa bbb",
+      "xa.b.c.",
+      "$who ${what}s $$ $. $",
+      "abcd abcbcd",
+      "a-b_c d",
+    };
+    for (const auto& p : patterns) {
+      const std::regex sre{p.begin(), p.end()};
+      const strtpl::nfa_regex nre{p};
+      for (const auto& s : inputs)
+        CHECK(test::matches(s, nre) == test::matches(s, sre));
+    }
+  }
+  { // syntax errors
+    CHECK_THROWS_AS(strtpl::nfa_regex("(a"), std::regex_error);
+    CHECK_THROWS_AS(strtpl::nfa_regex("a)"), std::regex_error);
+    CHECK_THROWS_AS(strtpl::nfa_regex("[a"), std::regex_error);
+    CHECK_THROWS_AS(strtpl::nfa_regex("*a"), std::regex_error);
+    CHECK_THROWS_AS(strtpl::nfa_regex("a{2}"), std::regex_error);
+    CHECK_THROWS_AS(strtpl::nfa_regex(R"(\1)"), std::regex_error);
+    CHECK_THROWS_AS(strtpl::nfa_regex(R"(\x4)"), std::regex_error);
+    CHECK_THROWS_AS(strtpl::nfa_regex(R"(\u{110000})"), std::regex_error);
+  }
+  { // hexadecimal escapes
+    CHECK(test::matches("aAb", strtpl::nfa_regex(R"(\x41)")) == "1:1;");
+    CHECK(test::matches("aAb", strtpl::nfa_regex(R"([\u0041-\u{42}]+)")) == "1:1;");
+    const strtpl::u32nfa_regex re{UR"([\u{80}-\u{10ffff}]+)"};
+    const auto [n, m] = strtpl::regex_count(std::u32string_view(U"ab🍌日本cd"), re);
+    CHECK(n == 1);
+    CHECK(m == 2);
+  }
+  { // \p{ID_Start} と \p{ID_Continue} は符号化した列を一つの文字として読む
+    const strtpl::nfa_regex re{R"(\p{ID_Start}\p{ID_Continue}*)"};
+    CHECK(test::matches("a1 名前。x\xff_", re) == "0:2;3:6;12:1;14:1;");
+    CHECK(test::matches("1\u00a0\u00e9", re) == "3:2;");
+    const strtpl::u16nfa_regex re16{uR"(\p{ID_Start}\p{ID_Continue}*)"};
+    const auto [n, m] = strtpl::regex_count(std::u16string_view(u"𠮷a・"), re16);
+    CHECK(n == 1);
+    CHECK(m == 1);
+    const std::u16string lone{u'a', char16_t(0xD842), u'b'};
+    CHECK(strtpl::regex_count(std::u16string_view(lone), re16).first == 2);
+    CHECK_THROWS_AS(strtpl::nfa_regex(R"(\p{Letter})"), std::regex_error);
+    CHECK_THROWS_AS(strtpl::nfa_regex(R"(\p{ID_Start)"), std::regex_error);
+    CHECK_THROWS_AS(strtpl::nfa_regex(R"([\p{ID_Start}])"), std::regex_error);
+  }
+  { // nfa_workspace は一度確保すれば以後の照合で使い回す
+    const strtpl::nfa_regex re{R"(\$(?:([a-z]+)|(\$)))"};
+    const std::string_view s = "$a $$ $bc";
+    std::vector<std::ptrdiff_t> caps(2 * (re.mark_count() + 1));
+    strtpl::nfa_workspace ws;
+    CHECK(re.search_from(s.begin(), s.end(), 0, caps, std::regex_constants::match_default, ws));
+    const auto* sets = ws.sets.data();
+    const auto* tcaps = ws.caps.data();
+    CHECK(re.search_from(s.begin(), s.end(), caps[1], caps, std::regex_constants::match_default,
+                         ws));
+    CHECK(caps[0] == 3);
+    CHECK(re.match_at(s.begin(), s.end(), 6, caps, std::regex_constants::match_default, ws));
+    CHECK(caps[3] == 9);
+    CHECK(ws.sets.data() == sets);
+    CHECK(ws.caps.data() == tcaps);
+    CHECK(test::matches(s, re) == test::matches(s, std::regex(R"(\$(?:([a-z]+)|(\$)))")));
+  }
+  { // long input does not consume the stack
+    const std::string s(1 << 20, 'a');
+    const strtpl::nfa_regex re{"(a|b)*c|a+"};
+    const auto [n, m] = strtpl::regex_count(std::string_view(s), re);
+    CHECK(n == 1);
+    CHECK(m == 0);
+  }
+}
+
+TEST_CASE("nfa_regex with utilities", "[nfa_regex]") {
+  const strtpl::nfa_regex re{R"(\d+)"};
+  { // regex_replace_fn
+    std::string_view s = "abc123def456ghi";
+    constexpr auto fn = [](auto&&) -> std::string_view { return "[$&]"; };
+    CHECK(strtpl::regex_replace_fn(s, re, fn) == "abc[123]def[456]ghi");
+    CHECK(strtpl::regex::regex_replace_fn(s, re, fn) == "abc[123]def[456]ghi");
+  }
+  { // regex_count
+    const auto [n, m] = strtpl::regex_count(std::string_view("1a22b333c"), re);
+    CHECK(n == 3);
+    CHECK(m == 1);
+  }
+  { // regex_split
+    std::string_view s = "abc123def456ghi";
+    std::string r;
+    std::ranges::copy(strtpl::regex::v2::regex_split(s, re, true) | std::views::join,
+                      std::back_inserter(r));
+    CHECK(r == s);
+  }
+  { // basic_string_template
+    using nfa_string_template =
+      strtpl::basic_string_template<char, std::char_traits<char>, strtpl::nfa_regex>;
+    constexpr nfa_string_template substitute{"$", "([_a-zA-Z][_a-zA-Z0-9]*)"};
+    std::unordered_map<std::string_view, std::string_view> map{
+      {"what", "example"},
+    };
+    CHECK(substitute("This is $what.", map) == "This is example.");
+    CHECK(substitute("This is ${what}ified.", map) == "This is exampleified.");
+    CHECK(substitute("This is dollar $$.", map) == "This is dollar $.");
+    CHECK_THROWS_AS(substitute("This is error $.", map), std::runtime_error);
+    CHECK_THROWS_AS(substitute("This is error too $which.", map), std::out_of_range);
+  }
+}
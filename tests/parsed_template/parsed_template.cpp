@@ -0,0 +1,314 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>   // std::fopen, std::fwrite, std::fclose, std::remove
+#include <cstdlib>  // std::mkstemp
+#include <cstring>  // std::memcpy
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <strtpl/mapped_file.hpp>
+#include <strtpl/parsed_template.hpp>
+#include <strtpl/value_map.hpp>
+#include <unistd.h> // ::close
+
+namespace {
+  // tpl(s, map) として直接呼び出せるか
+  template <class Tpl>
+  concept directly_callable =
+    requires(const Tpl& tpl, std::string_view s,
+             const std::unordered_map<std::string_view, std::string_view>& map) {
+    tpl(s, map);
+  };
+} // namespace
+
+TEST_CASE("parse", "[parsed_template]") {
+  const std::unordered_map<std::string_view, std::string_view> map{
+    {"who", "Alice"}, {"what", "banana"}, {"x", ""}};
+  { // render equals substitute
+    for (std::string_view s : {"", "plain text", "$who likes ${what}.", "$$who ${who}s $x$x$$",
+                               "$who$who$who", "a\nb $what\r\nc"}) {
+      const auto t = strtpl::parse(strtpl::substitute, s);
+      CHECK(t(map) == strtpl::substitute(s, map));
+      std::string r;
+      t.render(std::back_inserter(r), map);
+      CHECK(r == strtpl::substitute(s, map));
+    }
+  }
+  { // 値は書式として解釈しない (substitute は match_results::format を通す)
+    const std::unordered_map<std::string_view, std::string_view> prices{{"price", "$&!"}};
+    const std::string_view s = "[${price}]";
+    CHECK(strtpl::parse(strtpl::substitute, s)(prices) == "[$&!]");
+    CHECK(strtpl::substitute(s, prices) == "[${price}!]");
+  }
+  { // segments and keys
+    const auto t = strtpl::parse(strtpl::substitute, std::string_view("$$a $who ${who}$what"));
+    const auto v = t.view();
+    CHECK(v.key_count() == 2);
+    CHECK(v.key(0) == "who");
+    CHECK(v.key(1) == "what");
+    // エスケープした "$" と続く "a " は一つの literal にまとめる
+    CHECK(v.segments().size() == 5);
+    CHECK(v.literal_length() == 4);
+  }
+  { // value_map
+    const strtpl::value_map vm{{"who", "Bob"}, {"what", "apple"}};
+    CHECK(strtpl::parse(strtpl::substitute, std::string_view("$who: $what"))(vm) == "Bob: apple");
+  }
+  { // errors
+    CHECK_THROWS_AS(strtpl::parse(strtpl::substitute, std::string_view("a\nb $")),
+                    std::runtime_error);
+    const auto t = strtpl::parse(strtpl::substitute, std::string_view("a\r\n  $who ${nobody}"));
+    std::string msg;
+    try {
+      t(map);
+    } catch (const std::out_of_range& e) {
+      msg = e.what();
+    }
+    CHECK(msg == "Error: key not found: line 2, col 8");
+    CHECK(t.view().location(0) == std::pair<std::size_t, std::size_t>{0, 0});
+    CHECK(t.view().location(5) == std::pair<std::size_t, std::size_t>{1, 2});
+  }
+  { // many keys
+    std::string s;
+    std::unordered_map<std::string, std::string> values;
+    for (int i = 0; i < 40; ++i) {
+      const auto k = std::string("k").append(std::to_string(i));
+      s += "${" + k + "}-";
+      values.emplace(k, std::to_string(i));
+    }
+    const auto t = strtpl::parse(strtpl::substitute, std::string_view(s));
+    CHECK(t(strtpl::transparent(values)) == strtpl::substitute(s, strtpl::transparent(values)));
+  }
+  { // wchar_t
+    const std::unordered_map<std::wstring_view, std::wstring_view> wmap{{L"who", L"Alice"}};
+    const auto t = strtpl::parse(strtpl::wsubstitute, std::wstring_view(L"hi $who $$"));
+    CHECK(t(wmap) == L"hi Alice $");
+  }
+}
+
+TEST_CASE("serialize", "[parsed_template]") {
+  const std::unordered_map<std::string_view, std::string_view> map{{"who", "Alice"},
+                                                                    {"what", "banana"}};
+  { // round trip
+    const auto t = strtpl::parse(strtpl::substitute, std::string_view("$who\nlikes ${what}."));
+    const auto bytes = t.serialize();
+    CHECK(bytes.size() == t.view().serialized_size());
+    const auto v = strtpl::template_view::from_bytes(bytes);
+    CHECK(v(map) == "Alice\nlikes banana.");
+    CHECK(v.source() == "$who\nlikes ${what}.");
+    CHECK(v.serialize() == bytes);
+  }
+  { // invalid images
+    auto bytes = strtpl::parse(strtpl::substitute, std::string_view("$who")).serialize();
+    CHECK_THROWS_AS(strtpl::wtemplate_view::from_bytes(bytes), std::runtime_error);
+    CHECK_THROWS_AS(strtpl::template_view::from_bytes(std::span(bytes).first(bytes.size() - 1)),
+                    std::runtime_error);
+    bytes[0] = std::byte{0};
+    CHECK_THROWS_AS(strtpl::template_view::from_bytes(bytes), std::runtime_error);
+  }
+  { // segment, key, 行の内容を検査する
+    const auto t = strtpl::parse(strtpl::section_substitute,
+                                 std::string_view("${#rows}$who ${what|html}\n${/rows}."));
+    const auto image = t.serialize();
+    CHECK_NOTHROW(strtpl::template_view::from_bytes(image));
+    // i 番目の 4 byte の値を v にした領域
+    const auto with = [&image](std::size_t i, std::uint32_t v) {
+      auto r = image;
+      std::memcpy(r.data() + 4 * i, &v, sizeof(v));
+      return r;
+    };
+    const auto invalid = [](const std::vector<std::byte>& bytes) {
+      try {
+        strtpl::template_view::from_bytes(bytes);
+      } catch (const std::runtime_error&) {
+        return true;
+      }
+      return false;
+    };
+    // header は 8 個, segment は 4 個, key は 2 個の値。
+    // segment は section, who, " ", what, "\n", "." で、section の中身は 4 個
+    const std::size_t seg = 8, key = seg + 4 * 6, line = key + 2 * 2;
+    constexpr auto section = strtpl::template_segment::section;
+    CHECK(invalid(with(seg + 1, 1000)));           // section の名前の位置
+    CHECK(invalid(with(seg + 3, 6)));              // section の中身の数
+    CHECK(invalid(with(seg + 4, 5)));              // key の添字
+    CHECK(invalid(with(seg + 4 + 2, 0xffffffff))); // placeholder の長さ
+    CHECK(invalid(with(seg + 12 + 3, 9)));         // エスケープ
+    CHECK(not invalid(with(seg + 12 + 3, 4)));     // char では url も使える
+    CHECK(invalid(with(seg + 16, section)));       // 入れ子の section
+    CHECK(invalid(with(6, 0)));                    // literal の長さの合計
+    CHECK(invalid(with(7, 0)));                    // section の数
+    CHECK(invalid(with(key, 1000)));               // key の位置
+    CHECK(invalid(with(line + 1, 0)));             // 行の位置の順序
+    CHECK(invalid(with(line + 1, 1000)));          // 行の位置
+    CHECK(invalid(with(line, 1)));                 // 最初の行の位置は 0
+  }
+  { // bundle
+    std::vector<std::pair<std::string, strtpl::parsed_template>> items;
+    items.emplace_back("b", strtpl::parse(strtpl::substitute, std::string_view("B: $who")));
+    items.emplace_back("a", strtpl::parse(strtpl::substitute, std::string_view("A: ${what}")));
+    items.emplace_back("c", strtpl::parse(strtpl::substitute, std::string_view("")));
+    const auto bytes = strtpl::make_template_bundle(items);
+    const strtpl::template_bundle_view bundle(bytes);
+    CHECK(bundle.size() == 3);
+    CHECK(bundle.name(0) == "a");
+    CHECK(bundle.name(2) == "c");
+    CHECK(bundle[1](map) == "B: Alice");
+    CHECK(bundle.find("a").value()(map) == "A: banana");
+    CHECK(bundle.find("c").value()(map).empty());
+    CHECK(not bundle.find("d").has_value());
+    CHECK(not bundle.find("").has_value());
+    // 目録の名前の位置と順序を検査する (目録は 16 byte の header の後に 24 byte ずつ並ぶ)
+    const auto with_name_offset = [&bytes](std::size_t i, std::uint32_t v) {
+      auto r = bytes;
+      std::memcpy(r.data() + 16 + 24 * i, &v, sizeof(v));
+      return r;
+    };
+    CHECK_THROWS_AS(strtpl::template_bundle_view(with_name_offset(0, 1000)), std::runtime_error);
+    CHECK_THROWS_AS(strtpl::template_bundle_view(with_name_offset(2, 0)), std::runtime_error);
+  }
+}
+
+TEST_CASE("mapped_file", "[parsed_template]") {
+  const std::unordered_map<std::string_view, std::string_view> map{{"who", "Alice"}};
+  std::vector<std::pair<std::string, strtpl::parsed_template>> items;
+  items.emplace_back("greeting", strtpl::parse(strtpl::substitute, std::string_view("Hi, $who!")));
+  const auto bytes = strtpl::make_template_bundle(items);
+
+  char path[] = "/tmp/strtpl_bundle_XXXXXX";
+  const int fd = ::mkstemp(path);
+  REQUIRE(fd >= 0);
+  ::close(fd);
+  std::FILE* fp = std::fopen(path, "wb");
+  REQUIRE(fp != nullptr);
+  std::fwrite(bytes.data(), 1, bytes.size(), fp);
+  std::fclose(fp);
+
+  {
+    strtpl::mapped_file file(path);
+    CHECK(file.size() == bytes.size());
+    const strtpl::mapped_file moved = std::move(file);
+    CHECK(file.bytes().empty());
+    const strtpl::template_bundle_view bundle(moved.bytes());
+    CHECK(bundle.find("greeting").value()(map) == "Hi, Alice!");
+  }
+  std::remove(path);
+  CHECK_THROWS_AS(strtpl::mapped_file(path), std::system_error);
+}
+
+TEST_CASE("filters", "[parsed_template]") {
+  const std::unordered_map<std::string_view, std::string_view> map{
+    {"name", "<Tom & \"Jerry\">"}, {"q", "a b&c"}};
+  { // placeholder ごとのエスケープ
+    const auto t = strtpl::parse(strtpl::filtered_substitute,
+                                 std::string_view("<p>${name|html}</p> {\"n\": \"${name|json}\"} "
+                                                  "?q=${q|url} echo ${q|shell} $name"));
+    CHECK(t(map)
+          == "<p>&lt;Tom &amp; &quot;Jerry&quot;&gt;</p> {\"n\": \"<Tom & \\\"Jerry\\\">\"} "
+             "?q=a%20b%26c echo 'a b&c' <Tom & \"Jerry\">");
+    std::string r;
+    t.render(std::back_inserter(r), map);
+    CHECK(r == t(map));
+    // 直列化しても保たれる
+    CHECK(strtpl::template_view::from_bytes(t.serialize())(map) == t(map));
+  }
+  { // template 全体のエスケープ
+    const auto t = strtpl::parse(strtpl::filtered_substitute,
+                                 std::string_view("<b>$name</b>${name|raw}"));
+    CHECK(t(map, strtpl::escape::html)
+          == "<b>&lt;Tom &amp; &quot;Jerry&quot;&gt;</b><Tom & \"Jerry\">");
+  }
+  { // 未知のエスケープ
+    CHECK_THROWS_AS(strtpl::parse(strtpl::filtered_substitute, std::string_view("${q|xml}")),
+                    std::runtime_error);
+    // substitute では | を key の一部と見なさない
+    CHECK_THROWS_AS(strtpl::parse(strtpl::substitute, std::string_view("${q|html}")),
+                    std::runtime_error);
+    const std::unordered_map<std::wstring_view, std::wstring_view> wmap{{L"q", L"a b"}};
+    CHECK_THROWS_AS(strtpl::parse(strtpl::wfiltered_substitute, std::wstring_view(L"${q|url}")),
+                    std::runtime_error);
+    CHECK_THROWS_AS(strtpl::parse(strtpl::wfiltered_substitute, std::wstring_view(L"$q"))(
+                      wmap, strtpl::escape::url),
+                    std::invalid_argument);
+  }
+  { // ${key|name} を key として引かないよう、直接は呼び出せない
+    static_assert(directly_callable<strtpl::string_template>);
+    static_assert(not directly_callable<strtpl::template_grammar>);
+    static_assert(not directly_callable<decltype(strtpl::filtered_substitute)>);
+    const auto t = strtpl::parse(strtpl::u8filtered_substitute, std::u8string_view(u8"${名前|html}"));
+    const std::unordered_map<std::u8string_view, std::u8string_view> u8map{{u8"名前", u8"<a>"}};
+    CHECK(t(u8map) == u8"&lt;a&gt;");
+  }
+}
+
+TEST_CASE("sections", "[parsed_template]") {
+  using map_type = std::unordered_map<std::string_view, std::string_view>;
+  const map_type map{{"title", "Fruits"}, {"unit", "yen"}};
+  const std::unordered_map<std::string_view, std::vector<map_type>> sections{
+    {"rows",
+     {{{"name", "apple"}, {"price", "100"}},
+      {{"name", "<melon>"}, {"price", "900"}},
+      {{"name", "kiwi"}, {"price", "50"}, {"unit", "cent"}}}},
+    {"none", {}}};
+  { // 行ごとに繰り返す
+    const auto t = strtpl::parse(
+      strtpl::section_substitute,
+      std::string_view("<h1>$title</h1>\n${#rows}<li>${name|html}: $price $unit</li>\n${/rows}"
+                       "${#none}never${/none}end"));
+    CHECK(t.view().section_count() == 2);
+    const std::string expected = "<h1>Fruits</h1>\n"
+                                 "<li>apple: 100 yen</li>\n"
+                                 "<li>&lt;melon&gt;: 900 yen</li>\n"
+                                 "<li>kiwi: 50 cent</li>\n"
+                                 "end";
+    CHECK(t(map, sections) == expected);
+    std::string r;
+    t.render(std::back_inserter(r), map, sections);
+    CHECK(r == expected);
+    // 直列化しても保たれる
+    const auto bytes = t.serialize();
+    CHECK(strtpl::template_view::from_bytes(bytes)(map, sections) == expected);
+    // 行は value_map でもよい
+    const std::unordered_map<std::string_view, std::vector<strtpl::value_map>> vsections{
+      {"rows", {strtpl::value_map{{"name", "a"}, {"price", "1"}}}}, {"none", {}}};
+    CHECK(t(map, vsections) == "<h1>Fruits</h1>\n<li>a: 1 yen</li>\nend");
+  }
+  { // 見つからない section と key
+    const auto t = strtpl::parse(strtpl::section_substitute,
+                                 std::string_view("x\n${#rows}$name $missing${/rows}"));
+    CHECK_THROWS_AS(t(map), std::out_of_range);
+    std::string msg;
+    try {
+      t(map, std::unordered_map<std::string_view, std::vector<map_type>>{});
+    } catch (const std::out_of_range& e) {
+      msg = e.what();
+    }
+    CHECK(msg == "Error: section not found: line 2, col 4");
+    try {
+      t(map, sections);
+    } catch (const std::out_of_range& e) {
+      msg = e.what();
+    }
+    CHECK(msg == "Error: key not found: line 2, col 15");
+  }
+  { // 不正な section
+    for (std::string_view s : {"${#rows}", "${/rows}", "${#a}${/b}", "${#a}${#b}${/b}${/a}",
+                               "${#a|html}${/a}"})
+      CHECK_THROWS_AS(strtpl::parse(strtpl::section_substitute, s), std::runtime_error);
+    // substitute では section を使えない
+    CHECK_THROWS_AS(strtpl::parse(strtpl::substitute, std::string_view("${#a}${/a}")),
+                    std::runtime_error);
+  }
+  { // ${#rows} を key として引かないよう、直接は呼び出せない
+    static_assert(not directly_callable<decltype(strtpl::section_substitute)>);
+    const auto t = strtpl::parse(strtpl::u8section_substitute,
+                                 std::u8string_view(u8"${#行}${名前|html} ${/行}"));
+    using u8map_type = std::unordered_map<std::u8string_view, std::u8string_view>;
+    const u8map_type u8map;
+    const std::unordered_map<std::u8string_view, std::vector<u8map_type>> u8sections{
+      {u8"行", {{{u8"名前", u8"<a>"}}, {{u8"名前", u8"b"}}}}};
+    CHECK(t(u8map, u8sections) == u8"&lt;a&gt; b ");
+  }
+}
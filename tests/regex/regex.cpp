@@ -1,9 +1,46 @@
 #include <catch2/catch_test_macros.hpp>
 #include <ranges>
+#include <regex>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
+#include <strtpl/nfa_regex.hpp>
 #include <strtpl/regex.hpp>
 
+namespace {
+  // 探索の回数を数える照合エンジン
+  struct counting_regex {
+    using value_type = char;
+    strtpl::nfa_regex re;
+    mutable int searches = 0;
+
+    std::size_t
+    mark_count() const {
+      return re.mark_count();
+    }
+    template <class BiIter>
+    bool
+    search_from(BiIter first, BiIter last, std::ptrdiff_t pos, std::span<std::ptrdiff_t> caps,
+                std::regex_constants::match_flag_type flags) const {
+      ++searches;
+      return re.search_from(first, last, pos, caps, flags);
+    }
+    template <class BiIter>
+    bool
+    match_at(BiIter first, BiIter last, std::ptrdiff_t pos, std::span<std::ptrdiff_t> caps,
+             std::regex_constants::match_flag_type flags) const {
+      ++searches;
+      return re.match_at(first, last, pos, caps, flags);
+    }
+  };
+
+  // v2::regex_count の第 3 引数に Limit を渡せるか
+  template <class Limit>
+  concept countable_with = requires(std::string_view s, const std::regex& re, Limit n) {
+    strtpl::regex::v2::regex_count(s, re, n);
+  };
+} // namespace
+
 TEST_CASE("regex", "[regex]") {
   namespace regex = strtpl::regex;
   { // regex_range
@@ -20,7 +57,7 @@ TEST_CASE("regex", "[regex]") {
     constexpr auto fn = [](auto&&) -> std::string_view { return "exa"; };
     CHECK(regex::regex_replace_fn(s, re, fn) == "abcexadefexaghiexa");
   }
-  /* { // regex_count
+  { // regex_count
     std::string_view s = "1\n"
                          "2\r"
                          "12345";
@@ -28,7 +65,11 @@ TEST_CASE("regex", "[regex]") {
     auto [n, m] = regex::regex_count(s, re);
     CHECK(n == 2);
     CHECK(m == 5);
-  } */
+    CHECK(regex::regex_count(s, re, std::regex_constants::format_first_only)
+          == std::pair<std::ptrdiff_t, std::ptrdiff_t>{1, 7});
+    CHECK(regex::regex_count(std::string_view("abc"), re)
+          == std::pair<std::ptrdiff_t, std::ptrdiff_t>{0, 3});
+  }
 }
 
 TEST_CASE("regex v2", "[regex][v2]") {
@@ -54,11 +95,108 @@ TEST_CASE("regex v2", "[regex][v2]") {
     std::ranges::copy(regex::regex_split(s, re, true) | std::views::join, std::back_inserter(r));
     CHECK(r == s);
   }
-  // {
-  //   std::string_view s = "23+68*45-96/12";
-  //   const std::regex re{R"([\+\-\*/])"};
-  //   std::string r;
-  //   std::ranges::copy(regex::regex_split_n(s, re, 1) | std::views::join, std::back_inserter(r));
-  //   CHECK(r == "2368*45-96/12");
-  // }
+  { // regex_replace_fn
+    std::string_view s = "abc123def456ghi789";
+    const std::regex re{R"(\d+)"};
+    constexpr auto fn = [](auto&&) -> std::string_view { return "exa"; };
+    std::string r;
+    std::ranges::copy(regex::regex_replace_fn(s, re, fn) | std::views::join, std::back_inserter(r));
+    CHECK(r == strtpl::regex::regex_replace_fn(s, re, fn));
+    std::vector<std::string_view> chunks;
+    std::ranges::copy(regex::regex_replace_fn(s, re, fn), std::back_inserter(chunks));
+    CHECK(chunks
+          == std::vector<std::string_view>{"abc", "exa", "def", "exa", "ghi", "exa", "", ""});
+  }
+  {
+    std::string_view s = "abc";
+    const std::regex re{R"(\d+)"};
+    constexpr auto fn = [](auto&&) -> std::string_view { return "exa"; };
+    // 一致が無ければ入力全体を一つの断片として返す
+    std::vector<std::string_view> chunks;
+    std::ranges::copy(regex::regex_replace_fn(s, re, fn), std::back_inserter(chunks));
+    CHECK(chunks == std::vector<std::string_view>{"abc"});
+    std::string r;
+    std::ranges::copy(regex::regex_replace_fn(s, re, fn) | std::views::join, std::back_inserter(r));
+    CHECK(r == s);
+  }
+  { // format_first_only: 最初の一致だけを置換する
+    std::string_view s = "abc123def456ghi";
+    const std::regex re{R"(\d+)"};
+    constexpr auto fn = [](auto&&) -> std::string_view { return "#"; };
+    const auto flags = std::regex_constants::format_first_only;
+    std::vector<std::string_view> chunks;
+    std::ranges::copy(regex::regex_replace_fn(s, re, fn, flags), std::back_inserter(chunks));
+    CHECK(chunks == std::vector<std::string_view>{"abc", "#", "def456ghi", ""});
+    std::string r;
+    std::ranges::copy(regex::regex_replace_fn(s, strtpl::nfa_regex(R"(\d+)"), fn, flags)
+                        | std::views::join,
+                      std::back_inserter(r));
+    CHECK(r == strtpl::regex::regex_replace_fn(s, re, fn, flags));
+  }
+  { // format_no_copy: 一致しなかった部分を出力しない
+    std::string_view s = "abc123def456ghi";
+    const std::regex re{R"(\d+)"};
+    constexpr auto fn = [](auto&&) -> std::string_view { return "#"; };
+    const auto flags = std::regex_constants::format_no_copy;
+    std::string r;
+    std::ranges::copy(regex::regex_replace_fn(s, re, fn, flags) | std::views::join,
+                      std::back_inserter(r));
+    CHECK(r == std::regex_replace(std::string(s), re, "#", flags));
+    r.clear();
+    std::ranges::copy(regex::regex_replace_fn(std::string_view("abc"), re, fn, flags)
+                        | std::views::join,
+                      std::back_inserter(r));
+    CHECK(r.empty());
+    r.clear();
+    std::ranges::copy(regex::regex_replace_fn(s, re, fn,
+                                              flags | std::regex_constants::format_first_only)
+                        | std::views::join,
+                      std::back_inserter(r));
+    CHECK(r == "#");
+  }
+  { // regex_split_n
+    std::string_view s = "23+68*45-96/12";
+    const std::regex re{R"([\+\-\*/])"};
+    std::string r;
+    std::ranges::copy(regex::regex_split_n(s, re, 1) | std::views::join, std::back_inserter(r));
+    CHECK(r == "2368*45-96/12");
+    std::vector<std::string_view> fields;
+    for (const auto& x : regex::regex_split_n(s, re, 2, true))
+      fields.emplace_back(x.begin(), x.end());
+    CHECK(fields == std::vector<std::string_view>{"23+", "68*", "45-96/12"});
+    fields.clear();
+    for (const auto& x : regex::regex_split_n(s, re, 10))
+      fields.emplace_back(x.begin(), x.end());
+    CHECK(fields == std::vector<std::string_view>{"23", "68", "45", "96", "12"});
+    auto r0 = regex::regex_split_n(s, re, 0);
+    CHECK(r0.begin() == r0.end());
+  }
+  { // regex_count
+    std::string_view s = "a,b,c,d";
+    const std::regex re{","};
+    using regex::match_limit;
+    CHECK(regex::regex_count(s, re, match_limit(2))
+          == std::pair<std::ptrdiff_t, std::ptrdiff_t>{2, 3});
+    CHECK(regex::regex_count(s, re, match_limit(5))
+          == std::pair<std::ptrdiff_t, std::ptrdiff_t>{3, 1});
+    CHECK(regex::regex_count(s, re, match_limit(0))
+          == std::pair<std::ptrdiff_t, std::ptrdiff_t>{0, 7});
+    // 上限の位置に match_flag_type や整数を渡すことはできない
+    static_assert(countable_with<match_limit>);
+    static_assert(not countable_with<std::regex_constants::match_flag_type>);
+    static_assert(not countable_with<std::size_t>);
+  }
+  { // 上限に達した後は探索しない
+    std::string_view s = "a,b,c,d,e,f";
+    const counting_regex re{strtpl::nfa_regex(",")};
+    std::vector<std::string_view> fields;
+    for (const auto& x : regex::regex_split_n(s, re, 2))
+      fields.emplace_back(x.begin(), x.end());
+    CHECK(fields == std::vector<std::string_view>{"a", "b", "c,d,e,f"});
+    CHECK(re.searches == 2);
+    re.searches = 0;
+    CHECK(regex::regex_count(s, re, regex::match_limit(3))
+          == std::pair<std::ptrdiff_t, std::ptrdiff_t>{3, 5});
+    CHECK(re.searches == 3);
+  }
 }
@@ -0,0 +1,140 @@
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <strtpl/generator.hpp>
+#include <strtpl/render_chunks.hpp>
+
+namespace {
+  using string_map = std::unordered_map<std::string_view, std::string_view>;
+
+  template <class T>
+  concept chunkable = requires(T&& t, const string_map& map) {
+    strtpl::render_chunks(std::forward<T>(t), map);
+  };
+
+  // map の値類が M のときに作れるか
+  template <class M>
+  concept chunkable_with_map = requires(const strtpl::parsed_template& t, M&& map) {
+    strtpl::render_chunks(t, std::forward<M>(map));
+  };
+
+  template <class M>
+  concept chunkable_with_map_view = requires(strtpl::template_view t, M&& map) {
+    strtpl::render_chunks(t, std::forward<M>(map));
+  };
+
+  template <class M>
+  concept streamable_with_map = requires(std::string_view s, M&& map) {
+    strtpl::render_chunks(strtpl::string_template(), s, std::forward<M>(map));
+  };
+
+  template <class Range>
+  std::vector<std::string_view>
+  collect(Range&& r) {
+    std::vector<std::string_view> chunks;
+    for (const auto& x : r)
+      chunks.push_back(x);
+    return chunks;
+  }
+
+  strtpl::generator<int>
+  iota(int n) {
+    for (int i = 0; i < n; ++i)
+      co_yield i;
+  }
+} // namespace
+
+TEST_CASE("generator", "[render_chunks]") {
+  std::vector<int> v;
+  for (int x : iota(4))
+    v.push_back(x);
+  CHECK(v == std::vector<int>{0, 1, 2, 3});
+  auto g = iota(0);
+  CHECK(g.begin() == g.end());
+}
+
+TEST_CASE("render_chunks", "[render_chunks]") {
+  const std::unordered_map<std::string_view, std::string_view> map{
+    {"who", "Alice"}, {"what", "bananas"}, {"x", ""}};
+  { // string_template
+    const std::string_view s = "$who likes ${what}, $$5.$x";
+    const auto chunks = collect(strtpl::render_chunks(strtpl::substitute, s, map));
+    CHECK(chunks == std::vector<std::string_view>{"Alice", " likes ", "bananas", ", ", "$", "5."});
+    // literal は template を、値は map の文字列を直接指す
+    CHECK(chunks[1].data() == s.data() + 4);
+    CHECK(chunks[0].data() == map.at("who").data());
+  }
+  { // bounded chunks
+    const std::string_view s = "abcdefg $what hi";
+    const auto chunks = collect(strtpl::render_chunks(strtpl::substitute, s, map, 3));
+    CHECK(chunks
+          == std::vector<std::string_view>{"abc", "def", "g ", "ban", "ana", "s", " hi"});
+    std::string joined;
+    for (auto c : chunks)
+      joined += c;
+    CHECK(joined == strtpl::substitute(s, map));
+  }
+  { // 一時的な parsed_template からは作れない
+    static_assert(chunkable<const strtpl::parsed_template&>);
+    static_assert(chunkable<strtpl::template_view>);
+    static_assert(not chunkable<strtpl::parsed_template>);
+  }
+  { // 一時的な map からは作れない
+    static_assert(chunkable_with_map<const string_map&>);
+    static_assert(chunkable_with_map<string_map&>);
+    static_assert(not chunkable_with_map<string_map>);
+    static_assert(not chunkable_with_map<const string_map>);
+    static_assert(chunkable_with_map_view<string_map&>);
+    static_assert(not chunkable_with_map_view<string_map>);
+    static_assert(streamable_with_map<const string_map&>);
+    static_assert(not streamable_with_map<string_map>);
+  }
+  { // parsed template
+    const std::string_view s = "$who likes ${what}, $$5.$x tail";
+    const auto t = strtpl::parse(strtpl::substitute, s);
+    std::string joined;
+    for (auto c : strtpl::render_chunks(t, map, 4)) {
+      CHECK(c.size() <= 4);
+      joined += c;
+    }
+    CHECK(joined == strtpl::substitute(s, map));
+  }
+  { // suspends between chunks
+    const std::string s(1 << 20, 'x');
+    const auto t = strtpl::parse(strtpl::substitute, std::string_view(s));
+    auto h = strtpl::render_chunks(t, map, 16);
+    auto it = h.begin();
+    CHECK((*it).size() == 16);
+    ++it;
+    CHECK((*it).data() == t.view().source().data() + 16);
+  }
+  { // errors
+    const auto missing = strtpl::parse(strtpl::substitute, std::string_view("abc $nobody"));
+    auto g = strtpl::render_chunks(missing, map);
+    // 解析済みの template は最初の断片を返す前に送出する
+    CHECK_THROWS_AS(g.begin(), std::out_of_range);
+    auto h = strtpl::render_chunks(strtpl::substitute, std::string_view("abc $nobody"), map);
+    auto it = h.begin();
+    CHECK(*it == "abc ");
+    CHECK_THROWS_AS(++it, std::out_of_range);
+    auto i = strtpl::render_chunks(strtpl::substitute, std::string_view("$"), map);
+    CHECK_THROWS_AS(i.begin(), std::runtime_error);
+  }
+}
+
+TEST_CASE("render_chunks escape", "[render_chunks]") {
+  const std::unordered_map<std::string_view, std::string_view> map{{"x", "<&>"}, {"y", "a'b"}};
+  const auto t = strtpl::parse(strtpl::filtered_substitute,
+                               std::string_view("$x ${x|raw} ${y|shell}"));
+  std::string joined;
+  for (auto c : strtpl::render_chunks(t, map, 2, strtpl::escape::html)) {
+    CHECK(c.size() <= 2);
+    joined += c;
+  }
+  CHECK(joined == t(map, strtpl::escape::html));
+  CHECK(joined == "&lt;&amp;&gt; <&> 'a'\\''b'");
+}
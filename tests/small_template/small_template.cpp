@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <strtpl/small_template.hpp>
+#include <strtpl/value_map.hpp>
+
+TEST_CASE("inline_string", "[small_template]") {
+  strtpl::inline_string<8> s;
+  CHECK(s.empty());
+  CHECK(*s.c_str() == '\0');
+  s.append("abc").push_back('d');
+  CHECK(s == "abcd");
+  CHECK(s.size() == 4);
+  CHECK(s.c_str()[4] == '\0');
+  CHECK(s.str() == "abcd");
+  s.append("efgh");
+  CHECK(s == "abcdefgh");
+  CHECK_THROWS_AS(s.push_back('i'), std::length_error);
+  CHECK(s == "abcdefgh");
+  s.clear();
+  CHECK(s.view().empty());
+  static_assert(strtpl::inline_string<8>::capacity() == 8);
+}
+
+TEST_CASE("render_small", "[small_template]") {
+  const std::unordered_map<std::string_view, std::string_view> map{
+    {"svc", "api"}, {"region", "ap-northeast-1"}, {"code", "200"}, {"_x1", ""}};
+  { // substitute と一致する
+    for (std::string_view s :
+         {"", "plain", "svc=$svc,region=${region},code=$code", "$$svc $$$svc ${svc}s$_x1$_x1$$",
+          "$svc$code", "$svc-", "a\nb $code\r\nc", "100$$"}) {
+      CHECK(strtpl::render_small(s, map) == strtpl::substitute(s, map));
+    }
+    const strtpl::value_map vm{{"svc", "db"}};
+    CHECK(strtpl::render_small(std::string_view("svc=$svc"), vm) == "svc=db");
+  }
+  { // 値は書式として解釈しない (substitute は match_results::format を通す)
+    const std::unordered_map<std::string_view, std::string_view> prices{{"price", "$&!"}};
+    const std::string_view s = "[${price}]";
+    CHECK(strtpl::render_small(s, prices) == "[$&!]");
+    CHECK(strtpl::substitute(s, prices) == "[${price}!]");
+  }
+  { // 不正な placeholder は substitute と同じ位置を報告する
+    for (std::string_view s : {"$", "a $", "$1", "${", "${}", "${svc", "${svc-}", "a\r\nb ${1}",
+                               "$ svc", "${ svc}"}) {
+      std::string expected, actual;
+      try {
+        strtpl::substitute(s, map);
+      } catch (const std::runtime_error& err) {
+        expected = err.what();
+      }
+      try {
+        strtpl::render_small(s, map);
+      } catch (const std::runtime_error& err) {
+        actual = err.what();
+      }
+      CHECK(not expected.empty());
+      CHECK(actual == expected);
+    }
+    CHECK_THROWS_AS(strtpl::render_small(std::string_view("$nobody"), map), std::out_of_range);
+  }
+  { // 容量
+    CHECK(strtpl::render_small<7>(std::string_view("$svc$code"), map) == "api200");
+    CHECK_THROWS_AS(strtpl::render_small<5>(std::string_view("$svc$code"), map),
+                    std::length_error);
+  }
+  { // Unicode の文字型と wchar_t
+    const std::unordered_map<std::u8string_view, std::u8string_view> u8map{{u8"名前", u8"値"}};
+    CHECK(strtpl::render_small(std::u8string_view(u8"$名前 ${名前}"), u8map) == u8"値 値");
+    const std::unordered_map<std::wstring_view, std::wstring_view> wmap{{L"a", L"b"}};
+    CHECK(strtpl::render_small(std::wstring_view(L"$a$$"), wmap) == L"b$");
+    CHECK_THROWS_AS(strtpl::render_small(std::wstring_view(L"$あ"), wmap), std::runtime_error);
+  }
+  { // 空白や句読点は識別子に含めない (u8substitute と一致する)
+    const std::unordered_map<std::u8string_view, std::u8string_view> u8map{
+      {u8"price", u8"100"},
+      {u8"値段", u8"200"},
+    };
+    for (const std::u8string_view s : {u8"$price。", u8"${値段}！$値段、$price\u00a0円",
+                                       u8"($price)$値段\u3000", u8"${price}\u2003"})
+      CHECK(strtpl::render_small(s, u8map) == strtpl::u8substitute(s, u8map));
+    CHECK_THROWS_AS(strtpl::render_small(std::u8string_view(u8"$「price」"), u8map),
+                    std::runtime_error);
+    CHECK_THROWS_AS(strtpl::render_small(std::u8string_view(u8"${price。}"), u8map),
+                    std::runtime_error);
+    const std::unordered_map<std::u16string_view, std::u16string_view> u16map{{u"𠮷", u"x"}};
+    CHECK(strtpl::render_small(std::u16string_view(u"$𠮷・"), u16map) == u"x・");
+  }
+}
@@ -0,0 +1,79 @@
+#include <catch2/catch_test_macros.hpp>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <strtpl/regex.hpp>
+#include <strtpl/static_regex.hpp>
+#include <strtpl/string_template.hpp>
+
+TEST_CASE("static_regex", "[static_regex]") {
+  { // static_assert
+    using It = std::string_view::iterator;
+    using Re = strtpl::static_regex<R"((\d+)-(\d+))">;
+    static_assert(strtpl::regex_engine<Re, It>);
+    static_assert(Re::mark_count() == 2);
+    static_assert(std::is_empty_v<Re>);
+    // 照合結果の捕捉位置は固定長の配列に置く
+    using Match = std::iter_value_t<strtpl::engine_iterator<It, Re>>;
+    static_assert(std::is_same_v<Match, strtpl::engine_match<It, std::array<std::ptrdiff_t, 6>>>);
+  }
+  { // engine_iterator
+    std::string_view s = "1-2 34-56";
+    const auto& re = strtpl::static_regex_v<R"((\d+)-(\d+))">;
+    strtpl::engine_iterator<std::string_view::iterator, std::remove_cvref_t<decltype(re)>> it(
+      s.begin(), s.end(), re);
+    CHECK(it->ready());
+    CHECK(it->size() == 3);
+    CHECK(it->str(2) == "2");
+    ++it;
+    CHECK(it->str(0) == "34-56");
+    CHECK(it->position(1) == 4);
+    CHECK(++it == decltype(it)());
+    CHECK_FALSE(decltype(it)::value_type().ready());
+  }
+  { // search_from
+    std::string_view s = "ab12-345cd";
+    std::ptrdiff_t caps[6];
+    CHECK(strtpl::static_regex_v<R"((\d+)-(\d+))">.search_from(s.begin(), s.end(), 0, caps));
+    CHECK(caps[0] == 2);
+    CHECK(caps[1] == 8);
+    CHECK(caps[2] == 2);
+    CHECK(caps[3] == 4);
+    CHECK(caps[4] == 5);
+    CHECK(caps[5] == 8);
+    CHECK_FALSE(strtpl::static_regex_v<R"((\d+)-(\d+))">.match_at(s.begin(), s.end(), 0, caps));
+  }
+  { // regex_replace_fn
+    std::string_view s = "abc123def456ghi";
+    constexpr auto fn = [](auto&&) -> std::string_view { return "<$&>"; };
+    const std::regex re{R"(\d+)"};
+    CHECK(strtpl::regex_replace_fn<R"(\d+)">(s, fn) == strtpl::regex_replace_fn(s, re, fn));
+    CHECK(strtpl::regex::regex_replace_fn<R"(\d+)">(s, fn)
+          == strtpl::regex::regex_replace_fn(s, re, fn));
+    CHECK(strtpl::regex_replace_fn<R"(\d+)">(s, fn, std::regex_constants::format_first_only)
+          == strtpl::regex_replace_fn(s, re, fn, std::regex_constants::format_first_only));
+  }
+  { // regex_count
+    std::string_view s = "1\n"
+                         "2\r\n"
+                         "12345";
+    const std::regex re{R"((\r\n?|[\n\v\f]))"};
+    CHECK(strtpl::regex_count<R"((\r\n?|[\n\v\f]))">(s) == strtpl::regex_count(s, re));
+  }
+  { // regex_split
+    std::string_view s = "23+68*45-96/12";
+    std::string r;
+    std::ranges::copy(strtpl::regex::v2::regex_split<R"([\+\-\*/])">(s) | std::views::join,
+                      std::back_inserter(r));
+    CHECK(r == "2368459612");
+  }
+  { // wchar_t
+    std::wstring_view s = L"a1b22";
+    constexpr auto fn = [](auto&&) -> std::wstring_view { return L"#"; };
+    CHECK(strtpl::regex_replace_fn<LR"(\d+)">(s, fn) == L"a#b#");
+  }
+}
@@ -1,4 +1,5 @@
 #include <catch2/catch_test_macros.hpp>
+#include <string>
 #include <string_view>
 #include <unordered_map>
 #include <strtpl/string_template.hpp>
@@ -56,3 +57,84 @@ TEST_CASE("wchar_t", "[main]") {
     CHECK_THROWS_AS(strtpl::wsubstitute(s5, map), std::out_of_range);
   }
 }
+
+TEST_CASE("unicode", "[main]") {
+  { // regex_escape
+    CHECK(strtpl::regex_escape(std::u8string_view(u8"$C++$")) == u8R"(\$C\+\+\$)");
+    CHECK(strtpl::regex_escape(std::u16string_view(u"[a]")) == uR"(\[a\])");
+    CHECK(strtpl::regex_escape(std::u32string_view(U"a\\b")) == UR"(a\\b)");
+  }
+  { // u8substitute
+    std::unordered_map<std::u8string_view, std::u8string_view> map{
+      {u8"what", u8"例"},
+      {u8"名前", u8"アリス"},
+    };
+    std::u8string_view s1 = u8"これは $what です。";
+    std::u8string_view s2 = u8"${名前}さん、$$100";
+    std::u8string_view s3 = u8"$名前 さん";
+    CHECK(strtpl::u8substitute(s1, map) == u8"これは 例 です。");
+    CHECK(strtpl::u8substitute(s2, map) == u8"アリスさん、$100");
+    CHECK(strtpl::u8substitute(s3, map) == u8"アリス さん");
+    CHECK_THROWS_AS(strtpl::u8substitute(std::u8string_view(u8"$which"), map), std::out_of_range);
+  }
+  { // 空白や句読点は識別子に含めない
+    std::unordered_map<std::u8string_view, std::u8string_view> map{
+      {u8"price", u8"100"},
+      {u8"値段", u8"200"},
+    };
+    CHECK(strtpl::u8substitute(std::u8string_view(u8"$price。"), map) == u8"100。");
+    CHECK(strtpl::u8substitute(std::u8string_view(u8"$price\u00a0円"), map) == u8"100\u00a0円");
+    CHECK(strtpl::u8substitute(std::u8string_view(u8"$値段！"), map) == u8"200！");
+    CHECK(strtpl::u8substitute(std::u8string_view(u8"$price、$値段"), map) == u8"100、200");
+    CHECK(strtpl::u8substitute(std::u8string_view(u8"$price\u2003"), map) == u8"100\u2003");
+    CHECK(strtpl::u8substitute(std::u8string_view(u8"($price)"), map) == u8"(100)");
+    CHECK_THROWS_AS(strtpl::u8substitute(std::u8string_view(u8"$「price」"), map),
+                    std::runtime_error);
+    std::unordered_map<std::u16string_view, std::u16string_view> map16{{u"price", u"100"}};
+    CHECK(strtpl::u16substitute(std::u16string_view(u"$price。"), map16) == u"100。");
+    std::unordered_map<std::u32string_view, std::u32string_view> map32{{U"price", U"100"}};
+    CHECK(strtpl::u32substitute(std::u32string_view(U"$price🍌"), map32) == U"100🍌");
+  }
+  { // is_identifier_code_point
+    static_assert(not strtpl::is_identifier_code_point(U'a'));
+    static_assert(not strtpl::is_identifier_code_point(U'\u00a0'));
+    static_assert(strtpl::is_identifier_code_point(U'\u00aa'));
+    static_assert(strtpl::is_identifier_code_point(U'é'));
+    static_assert(not strtpl::is_identifier_code_point(U'×'));
+    static_assert(not strtpl::is_identifier_code_point(U'\u3000'));
+    static_assert(strtpl::is_identifier_code_point(U'々'));
+    static_assert(strtpl::is_identifier_code_point(U'ー'));
+    static_assert(not strtpl::is_identifier_code_point(U'・'));
+    static_assert(strtpl::is_identifier_code_point(U'\U00020bb7'));
+    static_assert(not strtpl::is_identifier_code_point(U'\U0010ffff'));
+    static_assert(not strtpl::is_identifier_code_point(0x110000));
+  }
+  { // u16substitute
+    std::unordered_map<std::u16string_view, std::u16string_view> map{
+      {u"what", u"example"},
+      {u"名前", u"🍌"},
+    };
+    CHECK(strtpl::u16substitute(std::u16string_view(u"This is $what."), map)
+          == u"This is example.");
+    CHECK(strtpl::u16substitute(std::u16string_view(u"${名前}!"), map) == u"🍌!");
+  }
+  { // u32substitute
+    std::unordered_map<std::u32string_view, std::u32string_view> map{
+      {U"what", U"example"},
+      {U"𠮷野", U"Yoshino"},
+    };
+    CHECK(strtpl::u32substitute(std::u32string_view(U"This is ${what}ified."), map)
+          == U"This is exampleified.");
+    CHECK(strtpl::u32substitute(std::u32string_view(U"$𠮷野"), map) == U"Yoshino");
+  }
+  { // error line/col
+    std::unordered_map<std::u16string_view, std::u16string_view> map;
+    std::string msg;
+    try {
+      strtpl::u16substitute(std::u16string_view(u"a\r\nbc\n日本 $."), map);
+    } catch (const std::runtime_error& err) {
+      msg = err.what();
+    }
+    CHECK(msg == "Invalid placeholder in string: line 3, col 4");
+  }
+}
@@ -38,7 +38,7 @@ TEST_CASE("trailing_view", "[trailing_view]") {
     static_assert(std::ranges::input_range<View>);
     static_assert(std::ranges::forward_range<View>);
     static_assert(std::ranges::bidirectional_range<View>);
-    // static_assert(std::ranges::random_access_range<View>); // currently not supported
+    static_assert(std::ranges::random_access_range<View>);
     static_assert(std::ranges::sized_range<View>);
     static_assert(std::ranges::common_range<View>);
     static_assert(std::assignable_from<decltype(access(*std::ranges::begin(tv))), int>);
@@ -53,7 +53,7 @@ TEST_CASE("trailing_view", "[trailing_view]") {
     static_assert(std::ranges::input_range<View>);
     static_assert(std::ranges::forward_range<View>);
     static_assert(std::ranges::bidirectional_range<View>);
-    // static_assert(std::ranges::random_access_range<View>); // currently not supported
+    static_assert(not std::ranges::random_access_range<View>);
     static_assert(not std::ranges::sized_range<View>);
     static_assert(not std::ranges::common_range<View>);
     static_assert(not std::assignable_from<decltype(access(*std::ranges::begin(tv))), int>);
@@ -68,7 +68,7 @@ TEST_CASE("trailing_view", "[trailing_view]") {
     static_assert(std::ranges::input_range<View>);
     static_assert(std::ranges::forward_range<View>);
     static_assert(std::ranges::bidirectional_range<View>);
-    // static_assert(std::ranges::random_access_range<View>); // currently not supported
+    static_assert(std::ranges::random_access_range<View>);
     static_assert(std::ranges::sized_range<View>);
     static_assert(std::ranges::common_range<View>);
     static_assert(not std::assignable_from<decltype(access(*std::ranges::begin(tv))), int>);
@@ -83,7 +83,7 @@ TEST_CASE("trailing_view", "[trailing_view]") {
     static_assert(std::ranges::input_range<View>);
     static_assert(std::ranges::forward_range<View>);
     static_assert(std::ranges::bidirectional_range<View>);
-    // static_assert(std::ranges::random_access_range<View>); // currently not supported
+    static_assert(not std::ranges::random_access_range<View>);
     static_assert(not std::ranges::sized_range<View>);
     static_assert(not std::ranges::common_range<View>);
     static_assert(not std::assignable_from<decltype(access(*std::ranges::begin(tv))), int>);
@@ -171,6 +171,50 @@ TEST_CASE("trailing_view", "[trailing_view]") {
   }
 }
 
+TEST_CASE("trailing_view random access", "[trailing_view][random_access]") {
+  // clang-format off
+  const auto v = GENERATE(
+    std::vector<int>{},
+    std::vector<int>{0},
+    std::vector<int>{0, 1, 2}
+  );
+  // clang-format on
+  const auto m = GENERATE(0, 1, 3);
+  auto tv = strtpl::trailing_view{v, m};
+  const auto n = std::ranges::ssize(tv);
+  const auto first = std::ranges::begin(tv);
+  const auto last = std::ranges::end(tv);
+  CHECK(last - first == n);
+  CHECK(first - last == -n);
+  CHECK(first + n == last);
+  CHECK(last - n == first);
+  for (std::ptrdiff_t i = 0; i < n; ++i) {
+    const auto [x, count] = tv[i];
+    const auto j = std::min(i, std::ranges::ssize(v) - 1);
+    CHECK(x == test::index(v, j));
+    CHECK(count == i - j);
+    CHECK(first[i] == *std::ranges::next(first, i));
+    CHECK((first + i) - first == i);
+    CHECK(first + i < last);
+    CHECK((last - (n - i)) == first + i);
+  }
+}
+
+TEST_CASE("trailing_view reverse", "[trailing_view][bidirectional]") {
+  std::vector<int> v{0, 1, 2};
+  auto tv = strtpl::trailing_view{v, 2};
+  std::vector<std::pair<int, std::ptrdiff_t>> r;
+  for (auto it = std::ranges::end(tv); it != std::ranges::begin(tv);) {
+    --it;
+    const auto [x, count] = *it;
+    r.emplace_back(x, count);
+  }
+  CHECK(r == std::vector<std::pair<int, std::ptrdiff_t>>{{2, 1}, {2, 0}, {1, 0}, {0, 0}});
+  // 末尾を指すイテレータの base() は基底の末尾を指す
+  CHECK(std::ranges::end(tv).base() == v.end());
+  CHECK(std::ranges::begin(tv).base() == v.begin());
+}
+
 TEST_CASE("trailing_view unreachable", "[trailing_view][unreachable]") {
   {
     std::vector<int> v{0, 1, 2, 3};
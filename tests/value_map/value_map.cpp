@@ -0,0 +1,94 @@
+#include <catch2/catch_test_macros.hpp>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <strtpl/string_template.hpp>
+#include <strtpl/value_map.hpp>
+
+TEST_CASE("value_map", "[value_map]") {
+  static_assert(strtpl::map_with_key_type<strtpl::value_map, std::string_view>);
+  { // find
+    const strtpl::value_map map{
+      {"who", "Alice"}, {"what", "banana"}, {"verb", "run"}, {"a", "1"}, {"who", "Bob"}};
+    CHECK(map.size() == 4);
+    CHECK(map.find("who")->second == "Alice");
+    CHECK(map.find("what")->second == "banana");
+    CHECK(map.find("verb")->second == "run");
+    CHECK(map.find("a")->second == "1");
+    CHECK(map.find("") == map.end());
+    CHECK(map.find("wha") == map.end());
+    CHECK(map.find("whom") == map.end());
+    CHECK(not map.contains("b"));
+  }
+  { // open-addressing tag index over many keys
+    std::vector<std::pair<std::string, std::string>> pairs;
+    for (int i = 0; i < 100; ++i)
+      pairs.emplace_back("key" + std::to_string(i), "value" + std::to_string(i));
+    const strtpl::value_map map(pairs);
+    CHECK(map.size() == 100);
+    for (const auto& [k, v] : pairs)
+      CHECK(map.find(k)->second == v);
+    CHECK(map.find("key100") == map.end());
+    CHECK(map.find("kez1") == map.end());
+  }
+  { // keys sharing the length and both end characters
+    std::vector<std::pair<std::string, std::string>> pairs;
+    for (char c = 'a'; c <= 'l'; ++c)
+      pairs.emplace_back(std::string("x") + c + "y", std::string(1, c));
+    const strtpl::value_map map(pairs);
+    for (const auto& [k, v] : pairs)
+      CHECK(map.find(k)->second == v);
+    CHECK(map.find("xzy") == map.end());
+  }
+  { // key10 ... key90 differ only in the middle character
+    std::vector<std::pair<std::string, std::string>> pairs;
+    for (int i = 1; i <= 9; ++i)
+      pairs.emplace_back("key" + std::to_string(i * 10), std::to_string(i));
+    for (char c = '1'; c <= '9'; ++c)
+      pairs.emplace_back(std::string{'k', c, 'y', '0'}, std::string{'k', c});
+    const strtpl::value_map map(pairs);
+    CHECK(map.size() == 18);
+    for (const auto& [k, v] : pairs)
+      CHECK(map.find(k)->second == v);
+    CHECK(map.find("key00") == map.end());
+    CHECK(map.find("key5") == map.end());
+  }
+  { // copy and move keep views valid
+    strtpl::value_map map{{"x", "1"}, {"y", "2"}};
+    const strtpl::value_map copy = map;
+    map = strtpl::value_map{{"z", "3"}};
+    CHECK(copy.find("x")->second == "1");
+    CHECK(copy.find("y")->second == "2");
+    strtpl::value_map moved = std::move(map);
+    CHECK(moved.find("z")->second == "3");
+  }
+  { // substitute
+    const strtpl::value_map map{{"who", "Alice"}, {"what", "banana"}};
+    CHECK(strtpl::substitute("$who likes ${what}.", map) == "Alice likes banana.");
+    CHECK_THROWS_AS(strtpl::substitute("$who likes $where.", map), std::out_of_range);
+  }
+  { // wide characters
+    const strtpl::u8value_map map{{u8"名前", u8"アリス"}};
+    CHECK(strtpl::u8substitute(std::u8string_view(u8"${名前}さん"), map) == u8"アリスさん");
+  }
+}
+
+TEST_CASE("transparent lookup", "[value_map]") {
+  { // unordered_string_map, string_map
+    const strtpl::unordered_string_map<std::string> umap{{"who", "Alice"}};
+    const strtpl::string_map<std::string> map{{"who", "Alice"}};
+    CHECK(strtpl::substitute("$who", umap) == "Alice");
+    CHECK(strtpl::substitute("$who", map) == "Alice");
+  }
+  { // transparent
+    const std::unordered_map<std::string, std::string> umap{{"who", "Alice"}};
+    const std::map<std::string, std::string> map{{"who", "Alice"}};
+    static_assert(not strtpl::map_with_key_type<decltype(umap), std::string_view>);
+    CHECK(strtpl::substitute("$who", strtpl::transparent(umap)) == "Alice");
+    CHECK(strtpl::substitute("$who", strtpl::transparent(map)) == "Alice");
+    CHECK_THROWS_AS(strtpl::substitute("$what", strtpl::transparent(umap)), std::out_of_range);
+  }
+}
@@ -0,0 +1,53 @@
+// strtpl_precompile <directory> <bundle>
+// directory 以下の全てのファイルを strtpl::substitute の規則で解析し、一つの束に直列化する。
+// 各 template の名前は directory からの相対パス ('/' 区切り) で、
+// 実行時は mapped_file と template_bundle_view で解析せずに読み込める
+#include <cstdio> // std::fprintf
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator> // std::istreambuf_iterator
+#include <string>
+#include <utility>
+#include <vector>
+#include <strtpl/parsed_template.hpp>
+
+int
+main(int argc, char* argv[]) {
+  if (argc != 3) {
+    std::fprintf(stderr, "usage: %s <directory> <bundle>\n", argv[0]);
+    return 2;
+  }
+  namespace fs = std::filesystem;
+  const fs::path root = argv[1];
+  std::vector<std::pair<std::string, strtpl::parsed_template>> items;
+  try {
+    for (const auto& entry : fs::recursive_directory_iterator(root)) {
+      if (not entry.is_regular_file())
+        continue;
+      std::ifstream in(entry.path(), std::ios::binary);
+      const std::string source{std::istreambuf_iterator<char>(in),
+                               std::istreambuf_iterator<char>()};
+      auto name = entry.path().lexically_relative(root).generic_string();
+      try {
+        items.emplace_back(std::move(name),
+                           strtpl::parse(strtpl::substitute, std::string_view(source)));
+      } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s: %s\n", entry.path().c_str(), e.what());
+        return 1;
+      }
+    }
+    const auto bytes = strtpl::make_template_bundle(items);
+    std::ofstream out(argv[2], std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bytes.data()),
+              static_cast<std::streamsize>(bytes.size()));
+    if (not out) {
+      std::fprintf(stderr, "%s: write failed\n", argv[2]);
+      return 1;
+    }
+    std::fprintf(stderr, "%zu templates, %zu bytes\n", items.size(), bytes.size());
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+}